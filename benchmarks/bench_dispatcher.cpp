@@ -0,0 +1,602 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QProcess>
+#include <QtCore/QSemaphore>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+#include <errno.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef Q_OS_UNIX
+#	include <sys/socket.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+#include "eventdispatcher_libuv.h"
+#include "process_libuv.h"
+
+#if __cplusplus >= 201103L
+#	define BENCH_NOTHROW noexcept
+#else
+#	define BENCH_NOTHROW throw()
+#endif
+
+#if QT_VERSION >= 0x050000
+#	define BENCH_SKIP(msg) QSKIP(msg)
+#else
+#	define BENCH_SKIP(msg) QSKIP(msg, SkipSingle)
+#endif
+
+/*
+ * Every heap allocation made by the process is counted while g_count_allocations is set; the activation
+ * allocation benchmarks use this to check that delivering an activation does not allocate. With glibc the
+ * malloc() family itself is replaced, which also catches the containers that grow through malloc()/realloc();
+ * elsewhere only operator new is counted.
+ */
+static volatile bool g_count_allocations = false;
+static QAtomicInt g_allocations;
+
+static inline void countAllocation(void)
+{
+	if (g_count_allocations) {
+		g_allocations.ref();
+	}
+}
+
+#ifdef __GLIBC__
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+
+	void* malloc(size_t size)
+	{
+		countAllocation();
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t n, size_t size)
+	{
+		countAllocation();
+		return __libc_calloc(n, size);
+	}
+
+	void* realloc(void* p, size_t size)
+	{
+		countAllocation();
+		return __libc_realloc(p, size);
+	}
+
+	int posix_memalign(void** p, size_t alignment, size_t size)
+	{
+		countAllocation();
+		*p = __libc_memalign(alignment, size);
+		return *p ? 0 : ENOMEM;
+	}
+}
+#else
+void* operator new(size_t size)
+{
+	countAllocation();
+
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) BENCH_NOTHROW
+{
+	free(p);
+}
+
+void operator delete[](void* p) BENCH_NOTHROW
+{
+	free(p);
+}
+#endif
+
+class TimerCounter : public QObject {
+	Q_OBJECT
+public:
+	TimerCounter(void) : QObject(), count(0) {}
+	int count;
+
+protected:
+	virtual void timerEvent(QTimerEvent*) { ++this->count; }
+};
+
+class EventCounter : public QObject {
+	Q_OBJECT
+public:
+	EventCounter(void) : QObject(), count(0) {}
+	int count;
+
+protected:
+	virtual void customEvent(QEvent*) { ++this->count; }
+};
+
+class SocketReader : public QObject {
+	Q_OBJECT
+public:
+	explicit SocketReader(int fd) : QObject(), count(0), m_fd(fd) {}
+	int count;
+
+public Q_SLOTS:
+	void readyRead(void)
+	{
+#ifdef Q_OS_UNIX
+		char c;
+		if (1 == ::read(this->m_fd, &c, 1)) {
+			++this->count;
+		}
+#endif
+	}
+
+private:
+	int m_fd;
+};
+
+class TickRecorder : public QObject {
+	Q_OBJECT
+public:
+	explicit TickRecorder(int capacity) : QObject(), ticks(), m_timer()
+	{
+		this->ticks.reserve(capacity);
+		this->m_timer.start();
+	}
+
+	QVector<qint64> ticks;
+
+protected:
+	virtual void timerEvent(QTimerEvent*)
+	{
+		if (this->ticks.size() < this->ticks.capacity()) {
+			this->ticks.append(this->m_timer.nsecsElapsed());
+		}
+	}
+
+private:
+	QElapsedTimer m_timer;
+};
+
+class ProcessSink : public QObject {
+	Q_OBJECT
+public:
+	ProcessSink(void) : QObject(), finished(0), bytes(0) {}
+	int finished;
+	qint64 bytes;
+
+public Q_SLOTS:
+	void processFinished(void) { ++this->finished; }
+	void readQProcess(void)    { this->bytes += static_cast<QProcess*>(this->sender())->readAllStandardOutput().size(); }
+	void readProcessLibUv(void) { this->bytes += static_cast<ProcessLibUv*>(this->sender())->readAllStandardOutput().size(); }
+};
+
+class WakeUpThread : public QThread {
+	Q_OBJECT
+public:
+	explicit WakeUpThread(QAbstractEventDispatcher* d) : QThread(), woken(0), m_go(), m_stop(false), m_dispatcher(d) {}
+
+	QAtomicInt woken;
+
+	void ping(void) { this->m_go.release(); }
+
+	void stop(void)
+	{
+		this->m_stop = true;
+		this->m_go.release();
+		this->wait();
+	}
+
+protected:
+	virtual void run(void)
+	{
+		for (;;) {
+			this->m_go.acquire();
+			if (this->m_stop) {
+				return;
+			}
+
+			this->woken.fetchAndStoreRelease(1);
+			this->m_dispatcher->wakeUp();
+		}
+	}
+
+private:
+	QSemaphore m_go;
+	volatile bool m_stop;
+	QAbstractEventDispatcher* m_dispatcher;
+};
+
+class BenchDispatcher : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void timerChurn(void);
+	void zeroTimers(void);
+	void socketNotifierActivation(void);
+	void wakeUpLatency(void);
+	void postedEvents(void);
+	void timerActivationAllocations(void);
+	void socketActivationAllocations(void);
+	void preciseTimerJitter_data(void);
+	void preciseTimerJitter(void);
+	void processSpawn_data(void);
+	void processSpawn(void);
+	void processOutput_data(void);
+	void processOutput(void);
+};
+
+void BenchDispatcher::timerChurn(void)
+{
+	TimerCounter obj;
+	QBENCHMARK {
+		for (int i=0; i<1000; ++i) {
+			int id = obj.startTimer(1000 + i);
+			obj.killTimer(id);
+		}
+	}
+}
+
+void BenchDispatcher::zeroTimers(void)
+{
+	TimerCounter obj;
+	for (int i=0; i<100; ++i) {
+		obj.startTimer(0);
+	}
+
+	QBENCHMARK {
+		obj.count = 0;
+		while (obj.count < 10000) {
+			QCoreApplication::processEvents();
+		}
+	}
+}
+
+void BenchDispatcher::socketNotifierActivation(void)
+{
+#ifdef Q_OS_UNIX
+	int fds[2];
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	SocketReader reader(fds[1]);
+	QSocketNotifier notifier(fds[1], QSocketNotifier::Read);
+	QObject::connect(&notifier, SIGNAL(activated(int)), &reader, SLOT(readyRead()));
+
+	QBENCHMARK {
+		for (int i=0; i<1000; ++i) {
+			int expected = reader.count + 1;
+			QCOMPARE(static_cast<int>(::write(fds[0], "x", 1)), 1);
+			while (reader.count < expected) {
+				QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+		}
+	}
+
+	::close(fds[0]);
+	::close(fds[1]);
+#else
+	BENCH_SKIP("socketpair() is not available");
+#endif
+}
+
+void BenchDispatcher::wakeUpLatency(void)
+{
+	QAbstractEventDispatcher* d = QAbstractEventDispatcher::instance();
+	WakeUpThread thread(d);
+	thread.start();
+
+	// Round trip: the other thread is released, wakes this one up, and processEvents() returns
+	QBENCHMARK {
+		thread.ping();
+		while (!thread.woken.testAndSetAcquire(1, 0)) {
+			d->processEvents(QEventLoop::WaitForMoreEvents);
+		}
+	}
+
+	thread.stop();
+}
+
+void BenchDispatcher::postedEvents(void)
+{
+	EventCounter obj;
+	QBENCHMARK {
+		for (int i=0; i<1000; ++i) {
+			QCoreApplication::postEvent(&obj, new QEvent(QEvent::User));
+		}
+
+		QCoreApplication::processEvents();
+	}
+
+	QCoreApplication::sendPostedEvents();
+}
+
+void BenchDispatcher::timerActivationAllocations(void)
+{
+	TimerCounter obj;
+	for (int i=0; i<10; ++i) {
+		obj.startTimer(1);
+	}
+
+	// Warm up: let the dispatcher and Qt grow their internal buffers
+	while (obj.count < 100) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	obj.count = 0;
+	g_allocations.fetchAndStoreRelaxed(0);
+	g_count_allocations = true;
+
+	while (obj.count < 1000) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	g_count_allocations = false;
+
+	// Allocations per timer activation
+	int allocations = g_allocations.fetchAndStoreRelaxed(0);
+	QTest::setBenchmarkResult(static_cast<qreal>(allocations) / obj.count, QTest::Events);
+
+	if (qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance())) {
+		QCOMPARE(allocations, 0);
+	}
+}
+
+void BenchDispatcher::socketActivationAllocations(void)
+{
+#ifdef Q_OS_UNIX
+	int fds[2];
+	QVERIFY(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	SocketReader reader(fds[1]);
+	QSocketNotifier notifier(fds[1], QSocketNotifier::Read);
+	QObject::connect(&notifier, SIGNAL(activated(int)), &reader, SLOT(readyRead()));
+
+	int allocations = 0;
+	for (int pass=0; pass<2; ++pass) {
+		// The first pass warms up the buffers, the second one is counted
+		const int n = pass ? 1000 : 100;
+		reader.count = 0;
+		g_allocations.fetchAndStoreRelaxed(0);
+		g_count_allocations = (1 == pass);
+
+		for (int i=0; i<n; ++i) {
+			int expected = reader.count + 1;
+			if (1 != ::write(fds[0], "x", 1)) {
+				break;
+			}
+
+			while (reader.count < expected) {
+				QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+		}
+
+		g_count_allocations = false;
+		allocations         = g_allocations.fetchAndStoreRelaxed(0);
+	}
+
+	::close(fds[0]);
+	::close(fds[1]);
+
+	QCOMPARE(reader.count, 1000);
+
+	// Allocations per socket notifier activation
+	QTest::setBenchmarkResult(static_cast<qreal>(allocations) / reader.count, QTest::Events);
+
+	if (qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance())) {
+		QCOMPARE(allocations, 0);
+	}
+#else
+	BENCH_SKIP("socketpair() is not available");
+#endif
+}
+
+void BenchDispatcher::preciseTimerJitter_data(void)
+{
+	QTest::addColumn<qint64>("interval");
+	QTest::addColumn<bool>("hires");
+
+	QTest::newRow("1ms")         << Q_INT64_C(1000000) << false;
+	QTest::newRow("1ms timerfd") << Q_INT64_C(1000000) << true;
+	QTest::newRow("500us")       << Q_INT64_C(500000)  << true;
+	QTest::newRow("250us")       << Q_INT64_C(250000)  << true;
+	QTest::newRow("100us")       << Q_INT64_C(100000)  << true;
+}
+
+void BenchDispatcher::preciseTimerJitter(void)
+{
+#if QT_VERSION >= 0x050200
+	QFETCH(qint64, interval);
+	QFETCH(bool, hires);
+
+	const int samples = 2000;
+	TickRecorder obj(samples);
+
+	int msec = static_cast<int>((interval + 999999) / 1000000);
+	int id   = obj.startTimer(msec, Qt::PreciseTimer);
+	QVERIFY(id > 0);
+
+	if (hires) {
+		EventDispatcherLibUv* d = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+		if (!d) {
+			obj.killTimer(id);
+			BENCH_SKIP("Nanosecond intervals are supported only by EventDispatcherLibUv");
+		}
+
+		QVERIFY(d->setPreciseTimerInterval(id, interval));
+	}
+
+	while (obj.ticks.size() < samples) {
+		QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	obj.killTimer(id);
+
+	// Mean absolute deviation of the tick period from the requested interval
+	qint64 total = 0;
+	for (int i=1; i<obj.ticks.size(); ++i) {
+		qint64 deviation = obj.ticks.at(i) - obj.ticks.at(i-1) - interval;
+		total += (deviation < 0) ? -deviation : deviation;
+	}
+
+	QTest::setBenchmarkResult(static_cast<qreal>(total) / (obj.ticks.size() - 1), QTest::WalltimeNanoseconds);
+#else
+	BENCH_SKIP("This benchmark requires Qt 5.2");
+#endif
+}
+
+void BenchDispatcher::processSpawn_data(void)
+{
+	QTest::addColumn<bool>("libuv");
+	QTest::newRow("QProcess") << false;
+	QTest::newRow("ProcessLibUv") << true;
+}
+
+void BenchDispatcher::processSpawn(void)
+{
+#ifdef Q_OS_UNIX
+	QFETCH(bool, libuv);
+	if (libuv && !qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance())) {
+		BENCH_SKIP("ProcessLibUv requires EventDispatcherLibUv");
+	}
+
+	// 50 short-lived children in flight at once, as a job scheduler would start them
+	const int n = 50;
+	QBENCHMARK {
+		ProcessSink sink;
+		QList<QObject*> processes;
+		for (int i=0; i<n; ++i) {
+			if (libuv) {
+				ProcessLibUv* p = new ProcessLibUv();
+				QObject::connect(p, SIGNAL(finished(qint64,int)), &sink, SLOT(processFinished()));
+				p->start(QLatin1String("/bin/true"));
+				processes.append(p);
+			}
+			else {
+				QProcess* p = new QProcess();
+				QObject::connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), &sink, SLOT(processFinished()));
+				p->start(QLatin1String("/bin/true"), QStringList());
+				processes.append(p);
+			}
+		}
+
+		while (sink.finished < n) {
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+
+		qDeleteAll(processes);
+	}
+#else
+	BENCH_SKIP("This benchmark requires a Unix system");
+#endif
+}
+
+void BenchDispatcher::processOutput_data(void)
+{
+	this->processSpawn_data();
+}
+
+void BenchDispatcher::processOutput(void)
+{
+#ifdef Q_OS_UNIX
+	QFETCH(bool, libuv);
+	if (libuv && !qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance())) {
+		BENCH_SKIP("ProcessLibUv requires EventDispatcherLibUv");
+	}
+
+	// 256 MiB through the child's standard output
+	const qint64 size = Q_INT64_C(256) << 20;
+	QStringList args;
+	args << QLatin1String("-c") << QString::number(size) << QLatin1String("/dev/zero");
+
+	QBENCHMARK {
+		ProcessSink sink;
+		QObject* process;
+		if (libuv) {
+			ProcessLibUv* p = new ProcessLibUv();
+			QObject::connect(p, SIGNAL(readyReadStandardOutput()), &sink, SLOT(readProcessLibUv()));
+			QObject::connect(p, SIGNAL(finished(qint64,int)), &sink, SLOT(processFinished()));
+			p->start(QLatin1String("head"), args);
+			process = p;
+		}
+		else {
+			QProcess* p = new QProcess();
+			QObject::connect(p, SIGNAL(readyReadStandardOutput()), &sink, SLOT(readQProcess()));
+			QObject::connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), &sink, SLOT(processFinished()));
+			p->start(QLatin1String("head"), args);
+			process = p;
+		}
+
+		while (!sink.finished) {
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		}
+
+		// QProcess may still hold output that has not been announced when finished() is emitted
+		if (!libuv) {
+			sink.bytes += static_cast<QProcess*>(process)->readAllStandardOutput().size();
+		}
+
+		delete process;
+		QCOMPARE(sink.bytes, size);
+	}
+#else
+	BENCH_SKIP("This benchmark requires a Unix system");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	// BENCH_DISPATCHER selects the dispatcher to measure: libuv (default), unix or glib
+	QByteArray which = qgetenv("BENCH_DISPATCHER");
+	const char* expected;
+	if (which.isEmpty() || "libuv" == which) {
+		which    = "libuv";
+		expected = "EventDispatcherLibUv";
+#if QT_VERSION >= 0x050000
+		QCoreApplication::setEventDispatcher(new EventDispatcherLibUv());
+#else
+		new EventDispatcherLibUv();
+#endif
+	}
+	else if ("unix" == which) {
+		expected = "QEventDispatcherUNIX";
+		qputenv("QT_NO_GLIB", "1");
+	}
+	else if ("glib" == which) {
+		// Qt falls back to its Unix dispatcher silently when it is built without GLib support
+		expected = "QEventDispatcherGlib";
+	}
+	else {
+		fprintf(stderr, "Unknown dispatcher %s; use libuv, unix or glib\n", which.constData());
+		return 1;
+	}
+
+	QCoreApplication app(argc, argv);
+
+	// Results recorded under the wrong name are worse than none
+	const char* actual = QAbstractEventDispatcher::instance()->metaObject()->className();
+	if (qstrcmp(actual, expected)) {
+		fprintf(stderr, "BENCH_DISPATCHER=%s requested %s, but the application runs %s\n", which.constData(), expected, actual);
+		return 2;
+	}
+
+	BenchDispatcher tc;
+	return QTest::qExec(&tc, argc, argv);
+}
+
+#include "bench_dispatcher.moc"
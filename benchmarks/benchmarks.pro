@@ -0,0 +1,22 @@
+QT      -= gui
+QT      += testlib
+TARGET   = bench_dispatcher
+CONFIG  += console release
+CONFIG  -= app_bundle
+SOURCES += bench_dispatcher.cpp
+
+INCLUDEPATH += $$PWD/../src
+DEPENDPATH  += $$PWD/../src
+
+CONFIG  *= link_prl
+LIBS    += -L$$OUT_PWD/../lib -leventdispatcher_libuv
+
+unix|*-g++* {
+	equals(QMAKE_PREFIX_STATICLIB, ""): QMAKE_PREFIX_STATICLIB = lib
+	equals(QMAKE_EXTENSION_STATICLIB, ""): QMAKE_EXTENSION_STATICLIB = a
+
+	PRE_TARGETDEPS *= $$OUT_PWD/../lib/$${QMAKE_PREFIX_STATICLIB}eventdispatcher_libuv$${LIB_SUFFIX}.$${QMAKE_EXTENSION_STATICLIB}
+}
+else:win32 {
+	PRE_TARGETDEPS *= $$OUT_PWD/../lib/eventdispatcher_libuv$${LIB_SUFFIX}.lib
+}
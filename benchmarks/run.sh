@@ -0,0 +1,22 @@
+#! /bin/sh
+
+# Runs the benchmarks with every dispatcher and stores QtTest XML results in the output directory
+# Usage: run.sh [path/to/bench_dispatcher] [output directory]
+# A dispatcher this Qt build does not provide (e.g. glib) is skipped and leaves no result file
+
+set -e
+
+BENCH=${1:-./bench_dispatcher}
+OUTDIR=${2:-results}
+
+mkdir -p "$OUTDIR"
+for d in libuv unix glib; do
+	rm -f "$OUTDIR/$d.xml"
+	rc=0
+	BENCH_DISPATCHER=$d "$BENCH" -xml -o "$OUTDIR/$d.xml" || rc=$?
+	if [ $rc -eq 2 ]; then
+		echo "Skipping $d: not available in this Qt build" >&2
+	elif [ $rc -ne 0 ]; then
+		exit $rc
+	fi
+done
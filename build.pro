@@ -1,7 +1,9 @@
 TEMPLATE = subdirs
 CONFIG  += ordered
 
-SUBDIRS = src tests
+SUBDIRS = src tests libuvtests benchmarks
 
-src.file   = src/eventdispatcher_libuv.pro
-tests.file = tests/qt_eventdispatcher_tests/build.pro
+src.file        = src/eventdispatcher_libuv.pro
+tests.file      = tests/qt_eventdispatcher_tests/build.pro
+libuvtests.file = tests/libuv/libuv.pro
+benchmarks.file = benchmarks/benchmarks.pro
@@ -0,0 +1,84 @@
+#include "asyncfile_libuv.h"
+#include "asyncfile_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+AsyncFileLibUv::AsyncFileLibUv(QObject* parent)
+	: QObject(parent), d_ptr(new AsyncFileLibUvPrivate(this))
+{
+}
+
+AsyncFileLibUv::~AsyncFileLibUv(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+QString AsyncFileLibUv::fileName(void) const
+{
+	Q_D(const AsyncFileLibUv);
+	return d->m_name;
+}
+
+bool AsyncFileLibUv::isOpen(void) const
+{
+	Q_D(const AsyncFileLibUv);
+	return -1 != d->m_fd;
+}
+
+void AsyncFileLibUv::open(const QString& fileName, QIODevice::OpenMode mode)
+{
+	Q_D(AsyncFileLibUv);
+	d->open(fileName, mode);
+}
+
+void AsyncFileLibUv::read(qint64 offset, int size)
+{
+	Q_D(AsyncFileLibUv);
+	d->read(offset, size);
+}
+
+void AsyncFileLibUv::write(qint64 offset, const QByteArray& data)
+{
+	Q_D(AsyncFileLibUv);
+	d->write(offset, data);
+}
+
+void AsyncFileLibUv::sync(void)
+{
+	Q_D(AsyncFileLibUv);
+	d->sync();
+}
+
+void AsyncFileLibUv::close(void)
+{
+	Q_D(AsyncFileLibUv);
+	d->close();
+}
+
+void AsyncFileLibUv::startStreaming(qint64 offset, int chunkSize, int maxInFlight)
+{
+	Q_D(AsyncFileLibUv);
+	d->startStreaming(offset, chunkSize, maxInFlight);
+}
+
+void AsyncFileLibUv::stopStreaming(void)
+{
+	Q_D(AsyncFileLibUv);
+	d->stopStreaming();
+}
+
+bool AsyncFileLibUv::isStreaming(void) const
+{
+	Q_D(const AsyncFileLibUv);
+	return d->m_streaming;
+}
+
+QString AsyncFileLibUv::errorString(int error)
+{
+	return QString::fromLatin1(uv_strerror(error));
+}
+
+#endif // UV_VERSION_MAJOR >= 1
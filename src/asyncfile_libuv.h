@@ -0,0 +1,60 @@
+#ifndef ASYNCFILE_LIBUV_H
+#define ASYNCFILE_LIBUV_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class AsyncFileLibUvPrivate;
+
+/*
+ * File I/O performed by libuv's thread pool on behalf of the EventDispatcherLibUv of the object's thread.
+ * All functions must be called from that thread; results are reported by signals emitted from the event loop,
+ * error arguments are negative libuv error codes (see errorString()) or 0 on success. Requires libuv 1.0+.
+ */
+class AsyncFileLibUv : public QObject {
+	Q_OBJECT
+public:
+	explicit AsyncFileLibUv(QObject* parent = 0);
+	virtual ~AsyncFileLibUv(void);
+
+	QString fileName(void) const;
+	bool isOpen(void) const;
+
+	// Fails with UV_EBUSY while the file is open or being opened or closed
+	void open(const QString& fileName, QIODevice::OpenMode mode);
+	void read(qint64 offset, int size);
+	void write(qint64 offset, const QByteArray& data);
+	void sync(void);
+	// The file is closed once the pending reads, writes and syncs have completed
+	void close(void);
+
+	// Reads the file sequentially in chunks with at most maxInFlight reads outstanding; chunks are reported in order
+	void startStreaming(qint64 offset = 0, int chunkSize = 65536, int maxInFlight = 4);
+	void stopStreaming(void);
+	bool isStreaming(void) const;
+
+	static QString errorString(int error);
+
+Q_SIGNALS:
+	void opened(int error);
+	void readFinished(qint64 offset, const QByteArray& data, int error);
+	void writeFinished(qint64 offset, qint64 written, int error);
+	void synced(int error);
+	void closed(int error);
+	void chunkRead(qint64 offset, const QByteArray& data);
+	// error is 0 when the end of the file has been reached
+	void streamFinished(int error);
+
+private:
+	Q_DISABLE_COPY(AsyncFileLibUv)
+	Q_DECLARE_PRIVATE(AsyncFileLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<AsyncFileLibUvPrivate> d_ptr;
+#else
+	AsyncFileLibUvPrivate* d_ptr;
+#endif
+};
+
+#endif // ASYNCFILE_LIBUV_H
@@ -0,0 +1,461 @@
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <fcntl.h>
+#include "asyncfile_libuv.h"
+#include "asyncfile_libuv_p.h"
+#include "eventdispatcher_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+FileRequest::FileRequest(AsyncFileLibUvPrivate* f, Type t, qint64 off)
+	: EventDispatcherLibUv::Task(), req(), disp(0), file(f), orphan(0), prev(0), next(0), buffer(), offset(off), result(0), stream(0), type(t)
+{
+	this->req.data = this;
+}
+
+void FileRequest::run(void)
+{
+	if (this->file) {
+		this->file->complete(this);
+		return;
+	}
+
+	// The file object is gone: only make sure the descriptor does not leak
+	if (Open == this->type && this->result >= 0) {
+		FileRequest::closeOrphan(this->disp, static_cast<uv_file>(this->result));
+	}
+	else if (this->orphan && !--this->orphan->pending) {
+		FileRequest::closeOrphan(this->disp, this->orphan->fd);
+		delete this->orphan;
+	}
+}
+
+void FileRequest::closeOrphan(EventDispatcherLibUvPrivate* disp, uv_file fd)
+{
+	FileRequest* r = new FileRequest(0, FileRequest::Close, 0);
+	if (uv_fs_close(disp->loop(), &r->req, fd, &FileRequest::fs_callback) < 0) {
+		delete r;
+		return;
+	}
+
+	r->disp = disp;
+	disp->requestStarted();
+}
+
+void FileRequest::fs_callback(uv_fs_t* req)
+{
+	FileRequest* r                    = static_cast<FileRequest*>(req->data);
+	EventDispatcherLibUvPrivate* disp = r->disp;
+
+	r->result = req->result;
+	uv_fs_req_cleanup(req);
+	disp->deferTask(r);
+	disp->requestFinished();
+}
+
+AsyncFileLibUvPrivate::AsyncFileLibUvPrivate(AsyncFileLibUv* const q)
+	: q_ptr(q), m_name(), m_fd(-1), m_in_flight(0), m_close_pending(false), m_open(0), m_requests(0),
+	  m_streaming(false), m_stream(0), m_next_offset(0), m_deliver_offset(0), m_end(-1), m_chunk(0),
+	  m_max_in_flight(0), m_stream_in_flight(0), m_stream_error(0), m_ready()
+{
+}
+
+AsyncFileLibUvPrivate::~AsyncFileLibUvPrivate(void)
+{
+	OrphanedFile* orphan = 0;
+	if (-1 != this->m_fd && this->m_in_flight) {
+		// Closing the descriptor under a pending write could redirect it to another file
+		orphan          = new OrphanedFile;
+		orphan->fd      = this->m_fd;
+		orphan->pending = this->m_in_flight;
+		this->m_fd      = -1;
+	}
+
+	for (FileRequest* r = this->m_requests; r; r = r->next) {
+		r->file = 0;
+		if (FileRequest::Open != r->type && FileRequest::Close != r->type) {
+			r->orphan = orphan;
+		}
+	}
+
+	if (-1 != this->m_fd) {
+		EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+		if (disp) {
+			FileRequest::closeOrphan(disp, this->m_fd);
+		}
+		else {
+			QT_CLOSE(this->m_fd);
+		}
+	}
+}
+
+EventDispatcherLibUvPrivate* AsyncFileLibUvPrivate::dispatcher(void)
+{
+	EventDispatcherLibUvPrivate* disp = EventDispatcherLibUvPrivate::current();
+	if (!disp) {
+		qWarning("AsyncFileLibUv: the thread does not run EventDispatcherLibUv");
+	}
+	else {
+		// Every request goes through the thread pool
+		EventDispatcherLibUvPrivate::threadPoolUsed();
+	}
+
+	return disp;
+}
+
+void AsyncFileLibUvPrivate::start(EventDispatcherLibUvPrivate* disp, FileRequest* r, int rc)
+{
+	r->disp = disp;
+	r->prev = 0;
+	r->next = this->m_requests;
+	if (this->m_requests) {
+		this->m_requests->prev = r;
+	}
+
+	this->m_requests = r;
+
+	if (FileRequest::Open != r->type && FileRequest::Close != r->type) {
+		++this->m_in_flight;
+	}
+
+	if (rc < 0) {
+		// Report the error asynchronously as well
+		r->result = rc;
+		disp->deferTask(r);
+	}
+	else {
+		disp->requestStarted();
+	}
+}
+
+void AsyncFileLibUvPrivate::fail(FileRequest* r, int error)
+{
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	this->start(disp, r, error);
+}
+
+void AsyncFileLibUvPrivate::unlink(FileRequest* r)
+{
+	if (r->prev) {
+		r->prev->next = r->next;
+	}
+	else {
+		this->m_requests = r->next;
+	}
+
+	if (r->next) {
+		r->next->prev = r->prev;
+	}
+}
+
+void AsyncFileLibUvPrivate::open(const QString& fileName, QIODevice::OpenMode mode)
+{
+	FileRequest* r = new FileRequest(this, FileRequest::Open, 0);
+	if (-1 != this->m_fd || this->m_close_pending || this->m_open) {
+		this->fail(r, UV_EBUSY);
+		return;
+	}
+
+	int flags = 0;
+	if ((mode & QIODevice::ReadWrite) == QIODevice::ReadWrite) {
+		flags = O_RDWR | O_CREAT;
+	}
+	else if (mode & QIODevice::WriteOnly) {
+		flags = O_WRONLY | O_CREAT;
+		// Like QFile, WriteOnly truncates unless Append is requested
+		if (!(mode & QIODevice::Append)) {
+			flags |= O_TRUNC;
+		}
+	}
+	else {
+		flags = O_RDONLY;
+	}
+
+	if (mode & QIODevice::Append) {
+		flags |= O_APPEND;
+	}
+
+	if (mode & QIODevice::Truncate) {
+		flags |= O_TRUNC;
+	}
+
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	this->m_name = fileName;
+	this->m_open = r;
+	int rc = uv_fs_open(disp->loop(), &r->req, QFile::encodeName(fileName).constData(), flags, 0666, &FileRequest::fs_callback);
+	this->start(disp, r, rc);
+}
+
+void AsyncFileLibUvPrivate::read(qint64 offset, int size)
+{
+	FileRequest* r = new FileRequest(this, FileRequest::Read, offset);
+	if (-1 == this->m_fd || this->m_close_pending) {
+		this->fail(r, UV_EBADF);
+		return;
+	}
+
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	// libuv reads straight into the array which is then handed to readFinished()
+	r->buffer.resize(qMax(size, 0));
+	uv_buf_t buf = uv_buf_init(r->buffer.data(), static_cast<unsigned int>(r->buffer.size()));
+	int rc       = uv_fs_read(disp->loop(), &r->req, this->m_fd, &buf, 1, offset, &FileRequest::fs_callback);
+	this->start(disp, r, rc);
+}
+
+void AsyncFileLibUvPrivate::write(qint64 offset, const QByteArray& data)
+{
+	FileRequest* r = new FileRequest(this, FileRequest::Write, offset);
+	if (-1 == this->m_fd || this->m_close_pending) {
+		this->fail(r, UV_EBADF);
+		return;
+	}
+
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	// The request keeps a shallow copy, so the data stays valid until the write completes
+	r->buffer    = data;
+	uv_buf_t buf = uv_buf_init(const_cast<char*>(r->buffer.constData()), static_cast<unsigned int>(r->buffer.size()));
+	int rc       = uv_fs_write(disp->loop(), &r->req, this->m_fd, &buf, 1, offset, &FileRequest::fs_callback);
+	this->start(disp, r, rc);
+}
+
+void AsyncFileLibUvPrivate::sync(void)
+{
+	FileRequest* r = new FileRequest(this, FileRequest::Sync, 0);
+	if (-1 == this->m_fd || this->m_close_pending) {
+		this->fail(r, UV_EBADF);
+		return;
+	}
+
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	int rc = uv_fs_fsync(disp->loop(), &r->req, this->m_fd, &FileRequest::fs_callback);
+	this->start(disp, r, rc);
+}
+
+void AsyncFileLibUvPrivate::close(void)
+{
+	if (-1 == this->m_fd || this->m_close_pending) {
+		this->fail(new FileRequest(this, FileRequest::Close, 0), UV_EBADF);
+		return;
+	}
+
+	this->stopStreaming();
+	this->m_close_pending = true;
+	if (!this->m_in_flight) {
+		this->issueClose();
+	}
+}
+
+void AsyncFileLibUvPrivate::issueClose(void)
+{
+	FileRequest* r = new FileRequest(this, FileRequest::Close, 0);
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		delete r;
+		return;
+	}
+
+	uv_file fd            = this->m_fd;
+	this->m_fd            = -1;
+	this->m_close_pending = false;
+
+	int rc = uv_fs_close(disp->loop(), &r->req, fd, &FileRequest::fs_callback);
+	this->start(disp, r, rc);
+}
+
+void AsyncFileLibUvPrivate::startStreaming(qint64 offset, int chunkSize, int maxInFlight)
+{
+	this->stopStreaming();
+
+	this->m_streaming        = true;
+	this->m_next_offset      = offset;
+	this->m_deliver_offset   = offset;
+	this->m_end              = -1;
+	this->m_chunk            = qMax(chunkSize, 1);
+	this->m_max_in_flight    = qMax(maxInFlight, 1);
+	this->m_stream_in_flight = 0;
+	this->m_stream_error     = (-1 == this->m_fd || this->m_close_pending) ? UV_EBADF : 0;
+
+	if (this->m_stream_error) {
+		// Let streamFinished() be emitted from the event loop
+		FileRequest* r = new FileRequest(this, FileRequest::StreamRead, offset);
+		r->stream      = this->m_stream;
+		++this->m_stream_in_flight;
+		this->fail(r, this->m_stream_error);
+		return;
+	}
+
+	this->issueStreamReads();
+}
+
+void AsyncFileLibUvPrivate::stopStreaming(void)
+{
+	// Reads still in flight belong to the old session and are ignored when they complete
+	++this->m_stream;
+	this->m_streaming = false;
+	this->m_ready.clear();
+}
+
+void AsyncFileLibUvPrivate::issueStreamReads(void)
+{
+	EventDispatcherLibUvPrivate* disp = AsyncFileLibUvPrivate::dispatcher();
+	if (!disp) {
+		return;
+	}
+
+	while (!this->m_stream_error && -1 == this->m_end && this->m_stream_in_flight + this->m_ready.size() < this->m_max_in_flight) {
+		FileRequest* r = new FileRequest(this, FileRequest::StreamRead, this->m_next_offset);
+		r->stream      = this->m_stream;
+		r->buffer.resize(this->m_chunk);
+
+		uv_buf_t buf = uv_buf_init(r->buffer.data(), static_cast<unsigned int>(r->buffer.size()));
+		int rc       = uv_fs_read(disp->loop(), &r->req, this->m_fd, &buf, 1, this->m_next_offset, &FileRequest::fs_callback);
+		this->start(disp, r, rc);
+
+		++this->m_stream_in_flight;
+		this->m_next_offset += this->m_chunk;
+	}
+}
+
+void AsyncFileLibUvPrivate::streamReadDone(FileRequest* r)
+{
+	Q_Q(AsyncFileLibUv);
+
+	if (r->stream != this->m_stream || !this->m_streaming) {
+		return;
+	}
+
+	--this->m_stream_in_flight;
+
+	if (r->result < 0) {
+		if (!this->m_stream_error) {
+			this->m_stream_error = static_cast<int>(r->result);
+		}
+	}
+	else {
+		if (r->result < this->m_chunk) {
+			// Short read: the file ends here, reads issued past this point return nothing
+			qint64 end = r->offset + r->result;
+			if (-1 == this->m_end || end < this->m_end) {
+				this->m_end = end;
+			}
+		}
+
+		if (r->result > 0) {
+			r->buffer.resize(static_cast<int>(r->result));
+			this->m_ready.insert(r->offset, r->buffer);
+		}
+	}
+
+	// Any slot may destroy the object
+	QPointer<AsyncFileLibUv> guard(q);
+	const quint32 stream = this->m_stream;
+	QMap<qint64, QByteArray>::Iterator it = this->m_ready.find(this->m_deliver_offset);
+	while (it != this->m_ready.end()) {
+		QByteArray data         = it.value();
+		qint64 offset           = it.key();
+		this->m_ready.erase(it);
+		this->m_deliver_offset += data.size();
+
+		Q_EMIT q->chunkRead(offset, data);
+		if (!guard) {
+			return;
+		}
+
+		if (stream != this->m_stream) {
+			// The slot has stopped or restarted streaming
+			return;
+		}
+
+		it = this->m_ready.find(this->m_deliver_offset);
+	}
+
+	this->issueStreamReads();
+
+	bool done = this->m_stream_error || (-1 != this->m_end && this->m_deliver_offset >= this->m_end);
+	if (done && !this->m_stream_in_flight) {
+		int error = this->m_stream_error;
+		this->stopStreaming();
+		Q_EMIT q->streamFinished(error);
+	}
+}
+
+void AsyncFileLibUvPrivate::complete(FileRequest* r)
+{
+	Q_Q(AsyncFileLibUv);
+
+	this->unlink(r);
+	if (FileRequest::Open != r->type && FileRequest::Close != r->type) {
+		--this->m_in_flight;
+		if (this->m_close_pending && !this->m_in_flight) {
+			this->issueClose();
+		}
+	}
+
+	// Signals go last: a slot may delete the object
+	int error = (r->result < 0) ? static_cast<int>(r->result) : 0;
+	switch (r->type) {
+		case FileRequest::Open:
+			// A request refused with UV_EBUSY is not the one in flight
+			if (r == this->m_open) {
+				this->m_open = 0;
+			}
+
+			if (!error) {
+				this->m_fd = static_cast<uv_file>(r->result);
+			}
+
+			Q_EMIT q->opened(error);
+			break;
+
+		case FileRequest::Read:
+			if (!error) {
+				r->buffer.resize(static_cast<int>(r->result));
+			}
+
+			Q_EMIT q->readFinished(r->offset, error ? QByteArray() : r->buffer, error);
+			break;
+
+		case FileRequest::Write:
+			Q_EMIT q->writeFinished(r->offset, error ? 0 : r->result, error);
+			break;
+
+		case FileRequest::Sync:
+			Q_EMIT q->synced(error);
+			break;
+
+		case FileRequest::Close:
+			Q_EMIT q->closed(error);
+			break;
+
+		case FileRequest::StreamRead:
+			this->streamReadDone(r);
+			break;
+	}
+}
+
+#endif // UV_VERSION_MAJOR >= 1
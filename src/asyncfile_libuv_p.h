@@ -0,0 +1,93 @@
+#ifndef ASYNCFILE_LIBUV_P_H
+#define ASYNCFILE_LIBUV_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+#include <uv.h>
+#include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+
+class AsyncFileLibUv;
+class AsyncFileLibUvPrivate;
+class EventDispatcherLibUvPrivate;
+
+// Descriptor left open by a destroyed AsyncFileLibUv; closed when its last request completes
+struct OrphanedFile {
+	uv_file fd;
+	int pending;
+};
+
+// A single uv_fs_* call; libuv's callback hands it to the dispatcher, which runs it after uv_run() returns
+class Q_DECL_HIDDEN FileRequest : public EventDispatcherLibUv::Task {
+public:
+	enum Type { Open, Read, Write, Sync, Close, StreamRead };
+
+	FileRequest(AsyncFileLibUvPrivate* f, Type t, qint64 off);
+	virtual void run(void);
+
+	uv_fs_t req;
+	EventDispatcherLibUvPrivate* disp;
+	AsyncFileLibUvPrivate* file; // 0 once the file object is destroyed
+	OrphanedFile* orphan;
+	FileRequest* prev;
+	FileRequest* next;
+	QByteArray buffer;
+	qint64 offset;
+	qint64 result;
+	quint32 stream;              // streaming session a StreamRead belongs to
+	Type type;
+
+	static void closeOrphan(EventDispatcherLibUvPrivate* disp, uv_file fd);
+	static void fs_callback(uv_fs_t* req);
+};
+
+class Q_DECL_HIDDEN AsyncFileLibUvPrivate {
+public:
+	AsyncFileLibUvPrivate(AsyncFileLibUv* const q);
+	~AsyncFileLibUvPrivate(void);
+
+	void open(const QString& fileName, QIODevice::OpenMode mode);
+	void read(qint64 offset, int size);
+	void write(qint64 offset, const QByteArray& data);
+	void sync(void);
+	void close(void);
+	void startStreaming(qint64 offset, int chunkSize, int maxInFlight);
+	void stopStreaming(void);
+	void complete(FileRequest* r);
+
+private:
+	Q_DISABLE_COPY(AsyncFileLibUvPrivate)
+	Q_DECLARE_PUBLIC(AsyncFileLibUv)
+	AsyncFileLibUv* const q_ptr;
+
+	QString m_name;
+	uv_file m_fd;
+	int m_in_flight;           // requests using m_fd
+	bool m_close_pending;
+	FileRequest* m_open;       // open request in flight
+	FileRequest* m_requests;   // all requests not completed yet
+
+	bool m_streaming;
+	quint32 m_stream;
+	qint64 m_next_offset;      // offset of the next read to issue
+	qint64 m_deliver_offset;   // offset of the next chunk to report
+	qint64 m_end;              // end of the file as seen by a short read, -1 if not known yet
+	int m_chunk;
+	int m_max_in_flight;
+	int m_stream_in_flight;
+	int m_stream_error;
+	QMap<qint64, QByteArray> m_ready; // chunks completed ahead of m_deliver_offset
+
+	static EventDispatcherLibUvPrivate* dispatcher(void);
+	void start(EventDispatcherLibUvPrivate* disp, FileRequest* r, int rc);
+	void fail(FileRequest* r, int error);
+	void unlink(FileRequest* r);
+	void issueClose(void);
+	void issueStreamReads(void);
+	void streamReadDone(FileRequest* r);
+
+	friend class FileRequest;
+};
+
+#endif // ASYNCFILE_LIBUV_P_H
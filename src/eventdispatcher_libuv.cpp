@@ -9,8 +9,25 @@ EventDispatcherLibUv::EventDispatcherLibUv(QObject* parent)
 {
 }
 
+EventDispatcherLibUv::EventDispatcherLibUv(uv_loop_t* loop, QObject* parent)
+	: QAbstractEventDispatcher(parent), d_ptr(new EventDispatcherLibUvPrivate(this, loop))
+{
+}
+
 EventDispatcherLibUv::~EventDispatcherLibUv(void)
 {
+	Q_D(EventDispatcherLibUv);
+
+	// The host's loop is not run from here: the private object outlives us until libuv has closed its handles
+	if (!d->m_owns_loop) {
+		d->detach();
+#if QT_VERSION >= 0x040600
+		this->d_ptr.take();
+#else
+		this->d_ptr = 0;
+#endif
+	}
+
 #if QT_VERSION < 0x040600
 	delete this->d_ptr;
 	this->d_ptr = 0;
@@ -37,7 +54,7 @@ void EventDispatcherLibUv::registerSocketNotifier(QSocketNotifier* notifier)
 		return;
 	}
 
-	if (notifier->thread() != thread() || thread() != QThread::currentThread()) {
+	if (notifier->thread() != thread()) {
 		qWarning("QSocketNotifier: socket notifiers cannot be enabled from another thread");
 		return;
 	}
@@ -48,6 +65,15 @@ void EventDispatcherLibUv::registerSocketNotifier(QSocketNotifier* notifier)
 	}
 
 	Q_D(EventDispatcherLibUv);
+	if (this->thread() != QThread::currentThread()) {
+#if QT_VERSION >= 0x040400
+		d->queueRegisterSocketNotifier(notifier);
+#else
+		qWarning("QSocketNotifier: socket notifiers cannot be enabled from another thread");
+#endif
+		return;
+	}
+
 	d->registerSocketNotifier(notifier);
 }
 
@@ -59,7 +85,7 @@ void EventDispatcherLibUv::unregisterSocketNotifier(QSocketNotifier* notifier)
 		return;
 	}
 
-	if (notifier->thread() != thread() || thread() != QThread::currentThread()) {
+	if (notifier->thread() != thread()) {
 		qWarning("QSocketNotifier: socket notifiers cannot be disabled from another thread");
 		return;
 	}
@@ -71,6 +97,15 @@ void EventDispatcherLibUv::unregisterSocketNotifier(QSocketNotifier* notifier)
 	}
 
 	Q_D(EventDispatcherLibUv);
+	if (this->thread() != QThread::currentThread()) {
+#if QT_VERSION >= 0x040400
+		d->queueUnregisterSocketNotifier(notifier);
+#else
+		qWarning("QSocketNotifier: socket notifiers cannot be disabled from another thread");
+#endif
+		return;
+	}
+
 	d->unregisterSocketNotifier(notifier);
 }
 
@@ -90,7 +125,7 @@ void EventDispatcherLibUv::registerTimer(
 	}
 
 	if (object->thread() != this->thread() && this->thread() != QThread::currentThread()) {
-		qWarning("%s: timers cannot be started from another thread", Q_FUNC_INFO);
+		qWarning("%s: timers cannot be started from another thread for objects living in another thread", Q_FUNC_INFO);
 		return;
 	}
 #endif
@@ -103,11 +138,21 @@ void EventDispatcherLibUv::registerTimer(
 #endif
 
 	Q_D(EventDispatcherLibUv);
+	const quint32 generation = d->nextGeneration();
+	if (this->thread() != QThread::currentThread()) {
+#if QT_VERSION >= 0x040400
+		d->queueRegisterTimer(timerId, interval, type, object, generation);
+#else
+		qWarning("%s: timers cannot be started from another thread", Q_FUNC_INFO);
+#endif
+		return;
+	}
+
 	if (interval) {
-		d->registerTimer(timerId, interval, type, object);
+		d->registerTimer(timerId, interval, type, object, generation);
 	}
 	else {
-		d->registerZeroTimer(timerId, object);
+		d->registerZeroTimer(timerId, object, generation);
 	}
 }
 
@@ -118,14 +163,21 @@ bool EventDispatcherLibUv::unregisterTimer(int timerId)
 		qWarning("%s: invalid arguments", Q_FUNC_INFO);
 		return false;
 	}
+#endif
 
+	Q_D(EventDispatcherLibUv);
 	if (this->thread() != QThread::currentThread()) {
+		// The result is not known until the command runs; Qt may reuse the id right away, so the command
+		// only affects the registration made before this call
+#if QT_VERSION >= 0x040400
+		d->queueUnregisterTimer(timerId, d->currentGeneration());
+		return true;
+#else
 		qWarning("%s: timers cannot be stopped from another thread", Q_FUNC_INFO);
 		return false;
-	}
 #endif
+	}
 
-	Q_D(EventDispatcherLibUv);
 	return d->unregisterTimer(timerId);
 }
 
@@ -136,14 +188,19 @@ bool EventDispatcherLibUv::unregisterTimers(QObject* object)
 		qWarning("%s: invalid arguments", Q_FUNC_INFO);
 		return false;
 	}
+#endif
 
-	if (object->thread() != this->thread() && this->thread() != QThread::currentThread()) {
+	Q_D(EventDispatcherLibUv);
+	if (this->thread() != QThread::currentThread()) {
+#if QT_VERSION >= 0x040400
+		d->queueUnregisterTimers(object, d->currentGeneration());
+		return true;
+#else
 		qWarning("%s: timers cannot be stopped from another thread", Q_FUNC_INFO);
 		return false;
-	}
 #endif
+	}
 
-	Q_D(EventDispatcherLibUv);
 	return d->unregisterTimers(object);
 }
 
@@ -185,12 +242,16 @@ void EventDispatcherLibUv::wakeUp(void)
 {
 	Q_D(EventDispatcherLibUv);
 
+	d->m_stats.wakeups.add(1);
+
 #if QT_VERSION >= 0x040400
-	if (d->m_wakeups.testAndSetAcquire(0, 1))
-#endif
-	{
-		uv_async_send(&d->m_wakeup);
+	if (!d->m_wakeups.testAndSetAcquire(0, 1)) {
+		d->m_stats.coalesced.add(1);
+		return;
 	}
+#endif
+
+	uv_async_send(&d->m_wakeup);
 }
 
 void EventDispatcherLibUv::interrupt(void)
@@ -204,6 +265,225 @@ void EventDispatcherLibUv::flush(void)
 {
 }
 
+void EventDispatcherLibUv::setSharedTimerAlignment(int gridMsec, int slackPercent)
+{
+	setSharedTimerGrid(gridMsec, slackPercent);
+}
+
+int EventDispatcherLibUv::sharedTimerAlignment(int* slackPercent)
+{
+	return sharedTimerGrid(slackPercent);
+}
+
+void EventDispatcherLibUv::setTimerWheelEnabled(bool enable)
+{
+	Q_D(EventDispatcherLibUv);
+	d->m_wheel_enabled = enable;
+}
+
+bool EventDispatcherLibUv::isTimerWheelEnabled(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	return d->m_wheel_enabled;
+}
+
+bool EventDispatcherLibUv::setPreciseTimerInterval(int timerId, qint64 nsec)
+{
+	Q_D(EventDispatcherLibUv);
+	return d->setPreciseTimerInterval(timerId, nsec);
+}
+
+void EventDispatcherLibUv::setBusyPollTime(int usec)
+{
+	Q_D(EventDispatcherLibUv);
+	d->m_busy_poll = (usec > 0) ? static_cast<quint64>(usec) * 1000 : 0;
+}
+
+int EventDispatcherLibUv::busyPollTime(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	return static_cast<int>(d->m_busy_poll / 1000);
+}
+
+void EventDispatcherLibUv::setDispatchBudget(ActivationSource source, const DispatchBudget& budget)
+{
+	Q_D(EventDispatcherLibUv);
+	SourceBudget& b = d->m_budget[source];
+	b.activations   = static_cast<quint64>(qMax(budget.maxActivations, 0));
+	b.time          = static_cast<quint64>(qMax(budget.maxTimeUsec, 0)) * 1000;
+}
+
+EventDispatcherLibUv::DispatchBudget EventDispatcherLibUv::dispatchBudget(ActivationSource source) const
+{
+	Q_D(const EventDispatcherLibUv);
+	DispatchBudget res;
+	res.maxActivations = static_cast<int>(d->m_budget[source].activations);
+	res.maxTimeUsec    = static_cast<int>(d->m_budget[source].time / 1000);
+	return res;
+}
+
+int EventDispatcherLibUv::addLoopHook(LoopPhase phase, LoopHook hook, void* data)
+{
+	Q_D(EventDispatcherLibUv);
+	return d->addLoopHook(phase, hook, data);
+}
+
+bool EventDispatcherLibUv::removeLoopHook(int id)
+{
+	Q_D(EventDispatcherLibUv);
+	return d->removeLoopHook(id);
+}
+
+uv_loop_t* EventDispatcherLibUv::uvLoop(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	return d->m_base;
+}
+
+void EventDispatcherLibUv::setHostDriven(bool enable)
+{
+	Q_D(EventDispatcherLibUv);
+	d->setHostDriven(enable);
+}
+
+bool EventDispatcherLibUv::isHostDriven(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	return d->m_host_driven;
+}
+
+bool EventDispatcherLibUv::watchUnixSignal(int signum)
+{
+	Q_D(EventDispatcherLibUv);
+	return d->watchSignal(signum);
+}
+
+void EventDispatcherLibUv::unwatchUnixSignal(int signum)
+{
+	Q_D(EventDispatcherLibUv);
+	d->unwatchSignal(signum);
+}
+
+bool EventDispatcherLibUv::isUnixSignalWatched(int signum) const
+{
+	Q_D(const EventDispatcherLibUv);
+	return d->m_signals.contains(signum);
+}
+
+EventDispatcherLibUv::SignalStatistics EventDispatcherLibUv::unixSignalStatistics(int signum) const
+{
+	Q_D(const EventDispatcherLibUv);
+	SignalStatistics res;
+	SignalInfo* info = d->m_signals.value(signum, 0);
+	res.received = info ? info->received : 0;
+	res.emitted  = info ? info->emitted  : 0;
+	return res;
+}
+
+EventDispatcherLibUv::PoolStatistics EventDispatcherLibUv::timerPoolStatistics(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	PoolStatistics res;
+	res.capacity      = d->m_timer_pool.capacity();
+	res.used          = d->m_timer_pool.used();
+	res.highWaterMark = d->m_timer_pool.highWaterMark();
+	return res;
+}
+
+EventDispatcherLibUv::PoolStatistics EventDispatcherLibUv::socketNotifierPoolStatistics(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	PoolStatistics res;
+	res.capacity      = d->m_notifier_pool.capacity();
+	res.used          = d->m_notifier_pool.used();
+	res.highWaterMark = d->m_notifier_pool.highWaterMark();
+	return res;
+}
+
+#if QT_VERSION >= 0x040400
+void EventDispatcherLibUv::postTask(Task* task)
+{
+	Q_D(EventDispatcherLibUv);
+	d->postTask(task);
+}
+
+void EventDispatcherLibUv::queueWork(Work* work)
+{
+	Q_D(EventDispatcherLibUv);
+	if (this->thread() != QThread::currentThread()) {
+		d->queueRemoteWork(work);
+	}
+	else {
+		d->queueWork(work);
+	}
+}
+#endif
+
+bool EventDispatcherLibUv::setThreadPoolSize(int size)
+{
+	return EventDispatcherLibUvPrivate::setThreadPoolSize(size);
+}
+
+EventDispatcherLibUv::Statistics EventDispatcherLibUv::statistics(void) const
+{
+	Q_D(const EventDispatcherLibUv);
+	const LoopStatistics& stats = d->m_stats;
+
+	Statistics res;
+	res.iterations        = stats.iterations.load();
+	res.blockedTime       = stats.blocked.load();
+	res.dispatchTime      = stats.dispatch.load();
+	res.timerActivations  = stats.timers.load();
+	res.socketActivations = stats.sockets.load();
+	res.zeroTimerPasses   = stats.zero_passes.load();
+	res.wakeUps           = stats.wakeups.load();
+	res.coalescedWakeUps  = stats.coalesced.load();
+	res.busyPollHits      = stats.spin_hits.load();
+	res.blockingWaits     = stats.blocks.load();
+	res.busyPollTime      = stats.spinning.load();
+	res.carriedOver       = stats.carried.load();
+	res.wakeUpsSaved      = stats.grid_saved.load();
+#if defined(UV_VERSION_HEX) && UV_VERSION_HEX >= 0x012700
+	// uv_metrics_idle_time() takes the loop's metrics lock and is safe to call from any thread
+	res.loopIdleTime      = uv_metrics_idle_time(d->m_base) - stats.idle_base.load();
+#else
+	res.loopIdleTime      = 0;
+#endif
+
+	for (int i=0; i<Statistics::LatenessBuckets; ++i) {
+		res.timerLateness[i] = stats.lateness[i].load();
+	}
+
+	return res;
+}
+
+void EventDispatcherLibUv::resetStatistics(void)
+{
+	Q_D(EventDispatcherLibUv);
+	LoopStatistics& stats = d->m_stats;
+
+	stats.iterations.reset();
+	stats.blocked.reset();
+	stats.dispatch.reset();
+	stats.timers.reset();
+	stats.sockets.reset();
+	stats.zero_passes.reset();
+	stats.wakeups.reset();
+	stats.coalesced.reset();
+	stats.spin_hits.reset();
+	stats.blocks.reset();
+	stats.spinning.reset();
+	stats.carried.reset();
+	stats.grid_saved.reset();
+#if defined(UV_VERSION_HEX) && UV_VERSION_HEX >= 0x012700
+	stats.idle_base.store(uv_metrics_idle_time(d->m_base));
+#endif
+
+	for (int i=0; i<LoopStatistics::LatenessBuckets; ++i) {
+		stats.lateness[i].reset();
+	}
+}
+
 EventDispatcherLibUv::EventDispatcherLibUv(EventDispatcherLibUvPrivate& dd, QObject* parent)
 	: QAbstractEventDispatcher(parent), d_ptr(&dd)
 {
@@ -2,13 +2,105 @@
 #define EVENTDISPATCHER_LIBUV_H
 
 #include <QtCore/QAbstractEventDispatcher>
+#if QT_VERSION >= 0x040400
+#	include <QtCore/QFuture>
+#	include <QtCore/QFutureInterface>
+#endif
 
 class EventDispatcherLibUvPrivate;
+typedef struct uv_loop_s uv_loop_t;
 
 class EventDispatcherLibUv : public QAbstractEventDispatcher {
 	Q_OBJECT
 public:
+	struct PoolStatistics {
+		int capacity;      // slots owned by the pool
+		int used;          // slots currently in use
+		int highWaterMark; // maximum number of slots ever used simultaneously
+	};
+
+	// Counters may be read from any thread; times are in nanoseconds
+	struct Statistics {
+		enum { LatenessBuckets = 16 };
+
+		quint64 iterations;        // processEvents() calls
+		quint64 blockedTime;       // time spent waiting for events in uv_run()
+		quint64 dispatchTime;      // the rest of the time spent in processEvents()
+		quint64 timerActivations;
+		quint64 socketActivations;
+		quint64 zeroTimerPasses;
+		quint64 wakeUps;           // wakeUp() calls
+		quint64 coalescedWakeUps;  // wakeUp() calls merged into an already pending wake up
+		quint64 busyPollHits;      // busy polls that found an event before the budget ran out
+		quint64 blockingWaits;     // waits in uv_run() that could block, including those after an unsuccessful busy poll
+		quint64 busyPollTime;      // time spent busy polling, not included in dispatchTime
+		quint64 carriedOver;       // activations left for the next iteration by a dispatch budget
+		quint64 wakeUpsSaved;      // coarse timers that expired on a shared grid point another expiration had already used
+		quint64 loopIdleTime;      // libuv's own idle time metric (libuv 1.39+), 0 if not available
+		// Timer lateness against the computed deadline, as of the loop iteration that delivers the timer event:
+		// bucket 0 counts timers late by less than 1 us, bucket i those late by [2^(i-1), 2^i) us, the last bucket
+		// all the later ones
+		quint64 timerLateness[LatenessBuckets];
+	};
+
+	enum ActivationSource {
+		TimerActivations,
+		SocketActivations
+	};
+
+	// Limits for one source per processEvents() call; 0 means no limit
+	struct DispatchBudget {
+		int maxActivations;
+		int maxTimeUsec;    // no further activations are delivered once this much time has been spent on the source
+	};
+
+	enum LoopPhase {
+		BeforePoll, // libuv's prepare phase, right before the loop polls for I/O (and possibly blocks)
+		AfterPoll,  // libuv's check phase, right after the poll returns
+		Idle        // every iteration; an idle hook keeps the loop from blocking
+	};
+
+	typedef void (*LoopHook)(void* data);
+
+	class Task {
+	public:
+		Task(void) : m_next(0), m_auto_delete(true) {}
+		virtual ~Task(void) {}
+		virtual void run(void) = 0;
+
+		bool autoDelete(void) const    { return this->m_auto_delete; }
+		void setAutoDelete(bool enable) { this->m_auto_delete = enable; }
+
+	private:
+		Q_DISABLE_COPY(Task)
+		friend class EventDispatcherLibUvPrivate;
+		Task* m_next;
+		bool m_auto_delete;
+	};
+
+	// execute() runs in libuv's thread pool, finish() then runs on the dispatcher's thread; the object is deleted afterwards
+	class Work {
+	public:
+		Work(void) : m_next(0), m_cancelled(false) {}
+		virtual ~Work(void) {}
+		virtual void execute(void) = 0;
+		virtual void finish(void) = 0;
+
+	protected:
+		// True if libuv cancelled the work before execute() was called
+		bool isCancelled(void) const { return this->m_cancelled; }
+
+	private:
+		Q_DISABLE_COPY(Work)
+		friend class EventDispatcherLibUvPrivate;
+		Work* m_next;
+		bool m_cancelled;
+	};
+
 	explicit EventDispatcherLibUv(QObject* parent = 0);
+	// Runs Qt's timers, notifiers and wake ups as handles on a loop owned by the caller, which must outlive the dispatcher.
+	// The destructor does not run the loop: its handles are released by the owner's next uv_run()
+	EventDispatcherLibUv(uv_loop_t* loop, QObject* parent);
 	virtual ~EventDispatcherLibUv(void);
 
 	virtual bool processEvents(QEventLoop::ProcessEventsFlags flags);
@@ -42,10 +134,163 @@ public:
 	virtual void interrupt(void);
 	virtual void flush(void);
 
+	// Opt-in and process wide: coarse and very coarse timers of all dispatchers are delayed by up to slackPercent
+	// of their interval to expire on a common grid of gridMsec milliseconds, so that the threads wake up together.
+	// Takes effect when the timers are next rearmed; gridMsec = 0 (the default) disables the grid
+	static void setSharedTimerAlignment(int gridMsec, int slackPercent = 10);
+	static int sharedTimerAlignment(int* slackPercent = 0);
+
+	void setTimerWheelEnabled(bool enable);
+	bool isTimerWheelEnabled(void) const;
+
+	bool setPreciseTimerInterval(int timerId, qint64 nsec);
+
+	// Before blocking, poll without waiting for up to usec microseconds; 0 (the default) disables busy polling
+	void setBusyPollTime(int usec);
+	int busyPollTime(void) const;
+
+	// Activations over the budget are delivered first by the next iteration, which does not block; meanwhile
+	// the other source, posted events and zero timers get their turn
+	void setDispatchBudget(ActivationSource source, const DispatchBudget& budget);
+	DispatchBudget dispatchBudget(ActivationSource source) const;
+
+	// The hook runs from within uv_run() on the dispatcher's thread: it must not reenter the event loop or send events,
+	// but it may post them. Returns an id for removeLoopHook(), 0 on failure. Dispatcher thread only
+	int addLoopHook(LoopPhase phase, LoopHook hook, void* data);
+	bool removeLoopHook(int id);
+
+	uv_loop_t* uvLoop(void) const;
+
+	// The loop's owner calls uv_run(), and Qt events are dispatched from the loop's check phase; processEvents() then
+	// never runs the loop itself. Nested event loops are not supported in this mode: libuv is not reentrant, so
+	// processEvents() called from a slot returns at once with a warning instead of waiting
+	void setHostDriven(bool enable);
+	bool isHostDriven(void) const;
+
+	// Counters for a watched signal; they start at 0 when watchUnixSignal() is called
+	struct SignalStatistics {
+		quint64 received;  // deliveries by the OS
+		quint64 emitted;   // unixSignal() emissions; signals received during the same loop iteration share one
+	};
+
+	// Delivers signum through unixSignal() on the dispatcher's thread instead of an asynchronous handler.
+	// These must be called from the dispatcher's thread
+	bool watchUnixSignal(int signum);
+	void unwatchUnixSignal(int signum);
+	bool isUnixSignalWatched(int signum) const;
+	SignalStatistics unixSignalStatistics(int signum) const;
+
+	PoolStatistics timerPoolStatistics(void) const;
+	PoolStatistics socketNotifierPoolStatistics(void) const;
+
+	Statistics statistics(void) const;
+	void resetStatistics(void);
+
+#if QT_VERSION >= 0x040400
+	// May be called from any thread; the task runs on the dispatcher's thread and is deleted afterwards if autoDelete() is set
+	void postTask(Task* task);
+
+	template<typename F>
+	void postCallable(F f) { this->postTask(new CallableTask<F>(f)); }
+
+	// May be called from any thread
+	void queueWork(Work* work);
+
+	// The future is completed on the dispatcher's thread
+	template<typename T, typename F>
+	QFuture<T> runInThreadPool(F f)
+	{
+		FutureWork<T, F>* work = new FutureWork<T, F>(f);
+		QFuture<T> res         = work->future();
+		this->queueWork(work);
+		return res;
+	}
+#endif
+
+	// Sets UV_THREADPOOL_SIZE; libuv reads it only once per process, so this fails once the pool may have started:
+	// after queueWork(), an AsyncFileLibUv operation, a host name lookup by TcpSocketLibUv, or the creation of
+	// a dispatcher on an external loop, whose owner may use the pool behind our back. Do not call qputenv() or
+	// getenv() from other threads meanwhile
+	static bool setThreadPoolSize(int size);
+
+Q_SIGNALS:
+	// count is the number of times signum was received since the previous emission
+	void unixSignal(int signum, int count);
+
 protected:
 	EventDispatcherLibUv(EventDispatcherLibUvPrivate& dd, QObject* parent = 0);
 
 private:
+	template<typename F>
+	class CallableTask : public Task {
+	public:
+		explicit CallableTask(F f) : Task(), m_f(f) {}
+		virtual void run(void) { this->m_f(); }
+
+	private:
+		F m_f;
+	};
+
+#if QT_VERSION >= 0x040400
+	template<typename T, typename F>
+	class FutureWork : public Work {
+	public:
+		explicit FutureWork(F f) : Work(), m_f(f), m_result(), m_interface() { this->m_interface.reportStarted(); }
+		QFuture<T> future(void) { return this->m_interface.future(); }
+
+		virtual void execute(void)
+		{
+			if (!this->m_interface.isCanceled()) {
+				this->m_result = this->m_f();
+			}
+		}
+
+		virtual void finish(void)
+		{
+			if (this->isCancelled() || this->m_interface.isCanceled()) {
+				this->m_interface.reportCanceled();
+			}
+			else {
+				this->m_interface.reportResult(this->m_result);
+			}
+
+			this->m_interface.reportFinished();
+		}
+
+	private:
+		F m_f;
+		T m_result;
+		QFutureInterface<T> m_interface;
+	};
+
+	template<typename F>
+	class FutureWork<void, F> : public Work {
+	public:
+		explicit FutureWork(F f) : Work(), m_f(f), m_interface() { this->m_interface.reportStarted(); }
+		QFuture<void> future(void) { return this->m_interface.future(); }
+
+		virtual void execute(void)
+		{
+			if (!this->m_interface.isCanceled()) {
+				this->m_f();
+			}
+		}
+
+		virtual void finish(void)
+		{
+			if (this->isCancelled() || this->m_interface.isCanceled()) {
+				this->m_interface.reportCanceled();
+			}
+
+			this->m_interface.reportFinished();
+		}
+
+	private:
+		F m_f;
+		QFutureInterface<void> m_interface;
+	};
+#endif
+
 	Q_DISABLE_COPY(EventDispatcherLibUv)
 	Q_DECLARE_PRIVATE(EventDispatcherLibUv)
 #if QT_VERSION >= 0x040600
@@ -3,15 +3,10 @@ TARGET   = eventdispatcher_libuv
 TEMPLATE = lib
 DESTDIR  = ../lib
 CONFIG  += staticlib create_prl release
-HEADERS += eventdispatcher_libuv.h eventdispatcher_libuv_p.h
-SOURCES += eventdispatcher_libuv.cpp eventdispatcher_libuv_p.cpp timers_p.cpp socknot_p.cpp
+HEADERS += eventdispatcher_libuv.h eventdispatcher_libuv_p.h objectpool_p.h timerwheel_p.h statistics_p.h asyncfile_libuv.h asyncfile_libuv_p.h tcpsocket_libuv.h tcpsocket_libuv_p.h process_libuv.h process_libuv_p.h fswatcher_libuv.h fswatcher_libuv_p.h threadgroup_libuv.h threadgroup_libuv_p.h
+SOURCES += eventdispatcher_libuv.cpp eventdispatcher_libuv_p.cpp timers_p.cpp socknot_p.cpp timerwheel_p.cpp hrtimers_p.cpp hostloop_p.cpp hooks_p.cpp signals_p.cpp tasks_p.cpp work_p.cpp streambuffer_p.cpp asyncfile_libuv.cpp asyncfile_libuv_p.cpp tcpsocket_libuv.cpp tcpsocket_libuv_p.cpp process_libuv.cpp process_libuv_p.cpp fswatcher_libuv.cpp fswatcher_libuv_p.cpp threadgroup_libuv.cpp threadgroup_libuv_p.cpp
 
-headers.files = eventdispatcher_libuv.h
-
-win32 {
-	HEADERS += win32_utils.h
-	SOURCES += win32_utils.cpp
-}
+headers.files = eventdispatcher_libuv.h asyncfile_libuv.h tcpsocket_libuv.h process_libuv.h fswatcher_libuv.h threadgroup_libuv.h
 
 unix {
 	CONFIG += create_pc
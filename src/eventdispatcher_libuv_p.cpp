@@ -1,56 +1,200 @@
 #include <QtCore/QCoreApplication>
+#include <QtCore/QSocketNotifier>
 #include "eventdispatcher_libuv.h"
 #include "eventdispatcher_libuv_p.h"
 
-#ifdef WIN32
-#	include "win32_utils.h"
+#if UV_VERSION_MAJOR >= 1
+namespace {
+
+	void count_handle(uv_handle_t* handle, void* arg)
+	{
+		Q_UNUSED(handle)
+		++*static_cast<int*>(arg);
+	}
+
+}
 #endif
 
-EventDispatcherLibUvPrivate::EventDispatcherLibUvPrivate(EventDispatcherLibUv* const q)
-	: q_ptr(q), m_interrupt(false), m_base(0), m_wakeup(),
+EventDispatcherLibUvPrivate::EventDispatcherLibUvPrivate(EventDispatcherLibUv* const q, uv_loop_t* loop)
+	: q_ptr(q), m_interrupt(false), m_loop_level(0), m_now(0), m_base(loop), m_owns_loop(!loop), m_host_driven(false),
+	  m_nested_warned(false), m_detached(false), m_closing(0),
+	  m_pump_prepare(), m_pump_check(), m_pump_idle(), m_wakeup(),
 #if QT_VERSION >= 0x040400
-	  m_wakeups(),
+	  m_wakeups(), m_generation(0),
+#endif
+	  m_notifiers(), m_idle_head(0), m_idle_tail(0), m_timers(), m_event_list(), m_event_spare(),
+	  m_deferred_notifiers(), m_deferred_timers(), m_notifiers_masked(0), m_timers_masked(0), m_serial(0),
+	  m_zero_timers(), m_object_timers(), m_zero_head(0), m_zero_tail(0), m_zero_cursor(0), m_zero_serial(0), m_zero_idle(), m_zero_ready(false), m_awaken(false),
+	  m_timer_pool(), m_notifier_pool(), m_zero_pool(), m_wheel(0), m_wheel_timer(), m_wheel_due(0),
+	  m_wheel_enabled(false), m_busy_poll(0), m_stats(),
+#if QT_VERSION >= 0x040400
+	  m_task_stack(0),
+#endif
+	  m_task_head(0), m_task_tail(0), m_work_pool(), m_done_head(0), m_done_tail(0), m_work_count(0),
+	  m_stream_buffers(), m_clients(0), m_signals(), m_signal_queue(), m_signal_task(this), m_signal_task_queued(false),
+	  m_hooks(), m_last_hook_id(0)
+#ifdef Q_OS_LINUX
+	, m_hires_timers(), m_hires_fd(-1), m_hires_poll(), m_hires_due(0)
 #endif
-	  m_notifiers(), m_timers(), m_event_list(), m_zero_timers(), m_awaken(false)
 {
+	memset(this->m_budget, 0, sizeof(this->m_budget));
+
+	if (this->m_owns_loop) {
 #if UV_VERSION_MAJOR < 1
-	this->m_base = uv_loop_new();
-	if (!this->m_base) {
-		qFatal("%s: failed to initialize the event loop", Q_FUNC_INFO);
-	}
+		this->m_base = uv_loop_new();
+		if (!this->m_base) {
+			qFatal("%s: failed to initialize the event loop", Q_FUNC_INFO);
+		}
 #else
-	this->m_base = new uv_loop_t;
-	uv_loop_init(this->m_base);
+		this->m_base = new uv_loop_t;
+		uv_loop_init(this->m_base);
 #endif
 
-	this->m_base->data = this;
+#if defined(UV_VERSION_HEX) && UV_VERSION_HEX >= 0x012700
+		uv_loop_configure(this->m_base, UV_METRICS_IDLE_TIME);
+#endif
+	}
+	else {
+		// The loop's owner may use the thread pool on its own
+		EventDispatcherLibUvPrivate::threadPoolUsed();
+	}
 
+	// The loop's data pointer belongs to the loop's owner: callbacks find the dispatcher through their handles
 	uv_async_init(this->m_base, &this->m_wakeup, EventDispatcherLibUvPrivate::wake_up_handler);
+	uv_idle_init(this->m_base, &this->m_zero_idle);
+	uv_timer_init(this->m_base, &this->m_wheel_timer);
+	uv_prepare_init(this->m_base, &this->m_pump_prepare);
+	uv_check_init(this->m_base, &this->m_pump_check);
+	uv_idle_init(this->m_base, &this->m_pump_idle);
+	this->m_wakeup.data       = this;
+	this->m_zero_idle.data    = this;
+	this->m_wheel_timer.data  = this;
+	this->m_pump_prepare.data = this;
+	this->m_pump_check.data   = this;
+	this->m_pump_idle.data    = this;
+	uv_unref(reinterpret_cast<uv_handle_t*>(&this->m_pump_prepare));
+	uv_unref(reinterpret_cast<uv_handle_t*>(&this->m_pump_check));
+	this->updateTime(false);
 }
 
 EventDispatcherLibUvPrivate::~EventDispatcherLibUvPrivate(void)
 {
-	if (this->m_base) {
-//		uv_close(&this->m_wakeup, 0);
+	if (this->m_detached) {
+		// Freed by reap(): libuv is done with every handle, only the tasks deferred since detach() are left
+		this->discardTasks();
+	}
+	else if (this->m_base) {
+		this->detachClients();
+		this->killHandles();
 
-		this->killTimers();
-		this->killSocketNotifiers();
+		// uv_loop_close() fails while there are requests in the thread pool
+		while (this->m_work_count) {
+			uv_run(this->m_base, UV_RUN_ONCE);
+		}
+
+		this->finishWork();
+		this->discardTasks();
+		this->closeHandles();
+
+		// Let libuv invoke the close callbacks so that all pooled slots are released
+		uv_run(this->m_base, UV_RUN_NOWAIT);
+	}
+
+#ifdef Q_OS_LINUX
+	if (-1 != this->m_hires_fd) {
+		::close(this->m_hires_fd);
+		this->m_hires_fd = -1;
+	}
+#endif
 
+	if (this->m_base && this->m_owns_loop) {
 #if UV_VERSION_MAJOR < 1
 		uv_loop_delete(this->m_base);
 #else
-		uv_loop_close(this->m_base);
-		delete this->m_base;
+		if (UV_EBUSY == uv_loop_close(this->m_base)) {
+			// Some handle or request was not closed through the dispatcher: freeing the loop would leave it dangling
+			int handles = 0;
+			uv_walk(this->m_base, &count_handle, &handles);
+			qWarning("EventDispatcherLibUv: the loop is still busy (%d handles left), leaking it", handles);
+		}
+		else {
+			delete this->m_base;
+		}
 #endif
+	}
+
+	this->m_base = 0;
+}
+
+void EventDispatcherLibUvPrivate::detach(void)
+{
+	Q_ASSERT(!this->m_owns_loop);
+
+	// Running the host's loop from here would fire the host's own callbacks from within a Qt destructor
+	this->detachClients();
+	this->killHandles();
+	this->finishWork();
+	this->discardTasks();
+	this->closeHandles();
+	this->m_detached = true;
+}
+
+void EventDispatcherLibUvPrivate::killHandles(void)
+{
+	this->killTimers();
+	this->killSocketNotifiers();
+	this->killSignals();
+	this->killLoopHooks();
+}
+
+void EventDispatcherLibUvPrivate::detachClients(void)
+{
+	// Sockets and servers may outlive the dispatcher, e.g. as children of the application object
+	while (this->m_clients) {
+		LoopClient* client = this->m_clients;
+		this->removeClient(client);
+		client->detachFromLoop();
+	}
+}
 
-		this->m_base = 0;
+void EventDispatcherLibUvPrivate::closeHandles(void)
+{
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_wakeup), &EventDispatcherLibUvPrivate::handle_close_callback);
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_zero_idle), &EventDispatcherLibUvPrivate::handle_close_callback);
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_wheel_timer), &EventDispatcherLibUvPrivate::handle_close_callback);
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_pump_prepare), &EventDispatcherLibUvPrivate::handle_close_callback);
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_pump_check), &EventDispatcherLibUvPrivate::handle_close_callback);
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_pump_idle), &EventDispatcherLibUvPrivate::handle_close_callback);
+	delete this->m_wheel;
+	this->m_wheel = 0;
+
+#ifdef Q_OS_LINUX
+	if (-1 != this->m_hires_fd) {
+		this->closeHandle(reinterpret_cast<uv_handle_t*>(&this->m_hires_poll), &EventDispatcherLibUvPrivate::handle_close_callback);
 	}
+#endif
+}
+
+void EventDispatcherLibUvPrivate::handle_close_callback(uv_handle_t* w)
+{
+	static_cast<EventDispatcherLibUvPrivate*>(w->data)->handleClosed();
 }
 
 bool EventDispatcherLibUvPrivate::processEvents(QEventLoop::ProcessEventsFlags flags)
 {
 	Q_Q(EventDispatcherLibUv);
 
+	if (this->m_host_driven && this->m_loop_level) {
+		// Called from a slot, with the host's uv_run() on the stack: libuv is not reentrant, so nothing
+		// new can arrive before the slot returns, and a nested event loop would only spin
+		if (!this->m_nested_warned) {
+			this->m_nested_warned = true;
+			qWarning("EventDispatcherLibUv: nested event loops are not supported in host driven mode");
+		}
+
+		return false;
+	}
+
 	const bool exclude_notifiers = (flags & QEventLoop::ExcludeSocketNotifiers);
 	const bool exclude_timers    = (flags & QEventLoop::X11ExcludeTimers);
 
@@ -59,6 +203,16 @@ bool EventDispatcherLibUvPrivate::processEvents(QEventLoop::ProcessEventsFlags f
 
 	this->m_interrupt = false;
 	this->m_awaken    = false;
+	++this->m_loop_level;
+
+	// Timers started by posted events are relative to this point; keep libuv's idea of now in sync
+	this->updateTime(true);
+
+	const quint64 started   = this->m_now;
+	const quint64 accounted = this->m_stats.accounted;
+	quint64 blocked         = 0;
+	quint64 spinning        = 0;
+	bool spun               = false;
 
 	bool result = q->hasPendingEvents();
 
@@ -69,105 +223,253 @@ bool EventDispatcherLibUvPrivate::processEvents(QEventLoop::ProcessEventsFlags f
 	QCoreApplication::sendPostedEvents();
 #endif
 
-	bool can_wait = !this->m_interrupt && (flags & QEventLoop::WaitForMoreEvents) && !result;
+	bool can_wait = !this->m_interrupt && (flags & QEventLoop::WaitForMoreEvents) && !result && this->m_event_list.isEmpty() && !this->m_task_head && !this->m_done_head;
 	uv_run_mode f = UV_RUN_NOWAIT;
 
 	if (!this->m_interrupt) {
-		if (!exclude_timers && this->m_zero_timers.size() > 0) {
-			result |= this->processZeroTimers();
-			if (result) {
-				can_wait = false;
-			}
+		// While there are zero timers, m_zero_idle keeps uv_run() from blocking
+		if (!this->m_timers_masked && this->m_zero_head) {
+			can_wait = false;
+		}
+
+		if (can_wait && this->m_busy_poll && !this->m_host_driven) {
+			const quint64 start = uv_hrtime();
+			spun                = this->busyPoll();
+			spinning            = uv_hrtime() - start;
+			can_wait            = !spun;
 		}
 
-		if (can_wait) {
+		if (can_wait && !this->m_host_driven) {
 			Q_EMIT q->aboutToBlock();
 			f = UV_RUN_ONCE;
+			this->m_stats.blocks.add(1);
 		}
 
+		const quint64 before = (UV_RUN_ONCE == f) ? uv_hrtime() : 0;
+
 		// Work around a bug when libev returns from ev_loop(loop, EVLOOP_ONESHOT) without processing any events
 //		do {
-			uv_run(this->m_base, f);
+			// A host driven loop is run by its owner, which calls us from pump_check_callback() with the activations collected
+			if (!this->m_host_driven && !spun) {
+				uv_run(this->m_base, f);
+			}
 //		} while (can_wait && !this->m_awaken && !this->m_event_list.size());
 
-#if QT_VERSION >= 0x040800
+		// uv_run() has just updated the loop time, so timers armed during this iteration use a consistent base
+		this->updateTime(false);
+		if (UV_RUN_ONCE == f) {
+			blocked = this->m_now - before;
+		}
+
+		// Keep the buffers: in the steady state delivering an activation does not allocate
 		EventList list;
+#if QT_VERSION >= 0x040800
 		this->m_event_list.swap(list);
+		this->m_event_list.swap(this->m_event_spare);
 #else
-		EventList list(this->m_event_list);
+		list = this->m_event_list;
 		this->m_event_list.clear();
 #endif
 
 		result |= (list.size() > 0) | this->m_awaken;
 
+		// Activations beyond a source's budget go back to m_event_list and are delivered first by the next iteration
+		quint64 delivered[2] = { 0, 0 };
+		quint64 spent[2]     = { 0, 0 };
+		quint64 carried      = 0;
 		for (int i=0; i<list.size(); ++i) {
 			const PendingEvent& e = list.at(i);
-			if (!e.first.isNull()) {
-				QCoreApplication::sendEvent(e.first, e.second);
+			if (e.socket && e.socket->serial == e.serial) {
+				e.socket->carried &= ~e.events;
+			}
+
+			if (e.timer && this->m_timers_masked) {
+				this->m_deferred_timers.append(e);
+			}
+			else if (e.socket && this->m_notifiers_masked) {
+				if (e.socket->serial == e.serial) {
+					this->deferSocketEvent(e.socket, e.events);
+				}
+			}
+			else {
+				const int source           = e.timer ? 0 : 1;
+				const SourceBudget& budget = this->m_budget[source];
+				if ((budget.activations && delivered[source] >= budget.activations) || (budget.time && spent[source] >= budget.time)) {
+					if (e.socket) {
+						// The watcher keeps reporting the descriptor meanwhile, socket_notifier_callback() must not queue it twice
+						e.socket->carried |= e.events;
+					}
+
+					this->m_event_list.append(e);
+					list[i].serial = 0; // not delivered yet, the timer must not be rearmed below
+					++carried;
+					continue;
+				}
+
+				const quint64 t0 = budget.time ? uv_hrtime() : 0;
+				if (this->deliverEvent(e)) {
+					++delivered[source];
+				}
+
+				if (budget.time) {
+					spent[source] += uv_hrtime() - t0;
+				}
 			}
 		}
 
-		struct timeval now;
-		gettimeofday(&now, 0);
+		this->m_stats.timers.add(delivered[0]);
+		this->m_stats.sockets.add(delivered[1]);
+		this->m_stats.carried.add(carried);
+
+		const quint64 now = this->m_now;
+
+		this->releaseIdleNotifiers(now);
 
 		// Now that all event handlers have finished (and we returned from the recusrion), reactivate all pending timers
 		for (int i=0; i<list.size(); ++i) {
 			const PendingEvent& e = list.at(i);
-			if (!e.first.isNull() && e.second->type() == QEvent::Timer) {
-				QTimerEvent* te = static_cast<QTimerEvent*>(e.second);
-				TimerHash::Iterator tit = this->m_timers.find(te->timerId());
-				if (tit != this->m_timers.end()) {
-					TimerInfo* info = tit.value();
-
-					uv_timer_t* tmp = &info->ev;
-					if (!uv_is_active(reinterpret_cast<uv_handle_t*>(tmp))) { // false in tst_QTimer::restartedTimerFiresTooSoon()
-						uint64_t delta = calculateNextTimeout(info, now);
-						uv_timer_start(tmp, &EventDispatcherLibUvPrivate::timer_callback, delta, 0);
-					}
+			if (e.timer && e.timer->serial == e.serial && !this->m_timers_masked) {
+				TimerInfo* info = e.timer;
+				if (!this->isTimerArmed(info)) { // false in tst_QTimer::restartedTimerFiresTooSoon()
+					uint64_t delta = calculateNextTimeout(info, now);
+					this->armTimer(info, delta);
 				}
 			}
+		}
 
-			delete e.second;
+#if QT_VERSION >= 0x040800
+		list.erase(list.begin(), list.end());
+		if (list.capacity() > this->m_event_spare.capacity()) {
+			this->m_event_spare.swap(list);
+		}
+#endif
+
+		// Tasks taken by wake_up_handler(), after the activations that were already due
+		result |= this->runTasks();
+
+		// Completions reported by after_work_callback() during this iteration are delivered as one batch
+		result |= this->finishWork();
+
+		// uv_run() is not reentrant, hence zero timers fire here rather than from zero_timer_callback()
+		if (!this->m_timers_masked && this->m_zero_ready) {
+			this->m_zero_ready = false;
+			result |= this->processZeroTimers();
 		}
 	}
 
 	exclude_notifiers && this->disableSocketNotifiers(false);
 	exclude_timers    && this->disableTimers(false);
 
+	// Time spent in nested loops has already been attributed by them
+	const quint64 span  = uv_hrtime() - started;
+	const quint64 inner = this->m_stats.accounted - accounted;
+	this->m_stats.iterations.add(1);
+	this->m_stats.blocked.add(blocked);
+	this->m_stats.spinning.add(spinning);
+	this->m_stats.dispatch.add((span > inner + blocked + spinning) ? span - inner - blocked - spinning : 0);
+	this->m_stats.accounted = accounted + span;
+
+	--this->m_loop_level;
 	return result;
 }
 
+/*
+ * Polls the loop without blocking until something arrives or the budget runs out. Cross-thread wake ups
+ * and posted events are noticed as well: both go through m_wakeup, whose handler sets m_awaken.
+ */
+bool EventDispatcherLibUvPrivate::busyPoll(void)
+{
+	Q_Q(EventDispatcherLibUv);
+
+	const quint64 deadline = uv_hrtime() + this->m_busy_poll;
+	do {
+		uv_run(this->m_base, UV_RUN_NOWAIT);
+		if (!this->m_event_list.isEmpty() || this->m_awaken || this->m_task_head || this->m_done_head || q->hasPendingEvents()) {
+			this->m_stats.spin_hits.add(1);
+			return true;
+		}
+	} while (!this->m_interrupt && uv_hrtime() < deadline);
+
+	return false;
+}
+
 bool EventDispatcherLibUvPrivate::processZeroTimers(void)
 {
-	bool result    = false;
-	QList<int> ids = this->m_zero_timers.keys();
-
-	for (int i=0; i<ids.size(); ++i) {
-		int tid = ids.at(i);
-		ZeroTimerHash::Iterator it = this->m_zero_timers.find(tid);
-		if (it != this->m_zero_timers.end()) {
-			ZeroTimer& data = it.value();
-			if (data.active) {
-				data.active = false;
-
-				QTimerEvent event(tid);
-				QCoreApplication::sendEvent(data.object, &event);
-				result   = true;
-
-				it = this->m_zero_timers.find(tid);
-				if (it != this->m_zero_timers.end()) {
-					ZeroTimer& data = it.value();
-					if (!data.active) {
-						data.active = true;
-					}
-				}
+	bool result = false;
+	this->m_stats.zero_passes.add(1);
+
+	// Timers registered during this pass (their serial is not less than the limit) wait for the next one
+	const quint64 limit = this->m_zero_serial;
+	ZeroTimerCursor cursor;
+	cursor.next        = this->m_zero_head;
+	cursor.outer       = this->m_zero_cursor;
+	this->m_zero_cursor = &cursor;
+
+	while (cursor.next && cursor.next->serial < limit) {
+		ZeroTimer* timer = cursor.next;
+		cursor.next      = timer->next;
+
+		if (timer->active) {
+			// unregisterTimer() called from the handler releases the timer, the cursor will be moved accordingly
+			int tid       = timer->timerId;
+			timer->active = false;
+
+			QTimerEvent event(tid);
+			QCoreApplication::sendEvent(timer->object, &event);
+			result = true;
+
+			ZeroTimerHash::ConstIterator it = this->m_zero_timers.constFind(tid);
+			if (it != this->m_zero_timers.constEnd() && it.value() == timer) {
+				timer->active = true;
 			}
 		}
 	}
 
+	this->m_zero_cursor = cursor.outer;
 	return result;
 }
 
+bool EventDispatcherLibUvPrivate::deliverEvent(const PendingEvent& e)
+{
+	// Unregistering a timer or a notifier invalidates the serial, so that the activations still queued for it are dropped
+	if (e.timer) {
+		TimerInfo* info = e.timer;
+		if (info->serial == e.serial) {
+			// Measured against the time taken after uv_run() returned; timer callbacks do not read the clock
+			const quint64 now = this->m_now;
+			this->m_stats.lateness[LoopStatistics::latenessBucket((now > info->due) ? now - info->due : 0)].add(1);
+
+			QTimerEvent event(info->timerId);
+			QCoreApplication::sendEvent(info->object, &event);
+			return true;
+		}
+	}
+	else {
+		SocketNotifierInfo* info = e.socket;
+		if (info->serial == e.serial) {
+			QSocketNotifier* notifier = (e.events & UV_READABLE) ? info->read : info->write;
+			if (notifier) {
+				QEvent event(QEvent::SockAct);
+				QCoreApplication::sendEvent(notifier, &event);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void EventDispatcherLibUvPrivate::zero_timer_callback(
+	uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->data);
+	disp->m_zero_ready = true;
+}
+
 void EventDispatcherLibUvPrivate::wake_up_handler(
 	uv_async_t* w
 #if UV_VERSION_MAJOR < 1
@@ -175,7 +477,7 @@ void EventDispatcherLibUvPrivate::wake_up_handler(
 #endif
 )
 {
-	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->loop->data);
+	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->data);
 	disp->m_awaken = true;
 
 #if QT_VERSION >= 0x040400
@@ -183,4 +485,7 @@ void EventDispatcherLibUvPrivate::wake_up_handler(
 		qCritical("%s: internal error, wakeUps.testAndSetRelease(1, 0) failed!", Q_FUNC_INFO);
 	}
 #endif
+
+	// Tasks posted from now on wake the loop up again
+	disp->takeTasks();
 }
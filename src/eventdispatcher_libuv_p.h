@@ -3,80 +3,518 @@
 
 #include <qplatformdefs.h>
 #include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QByteArray>
 #include <QtCore/QHash>
-#include <QtCore/QPointer>
+#include <QtCore/QList>
+#include <QtCore/QVector>
 #include <uv.h>
 
 #if QT_VERSION >= 0x040400
 #	include <QtCore/QAtomicInt>
+#	include <QtCore/QAtomicPointer>
 #endif
 
 #include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+#include "objectpool_p.h"
+#include "timerwheel_p.h"
+#include "statistics_p.h"
+
+class EventDispatcherLibUvPrivate;
 
 struct TimerInfo {
 	QObject* object;
-	uv_timer_t ev;
-	struct timeval when;
+	EventDispatcherLibUvPrivate* disp;
+	TimerInfo* obj_prev; // links in the object's list, see m_object_timers
+	TimerInfo* obj_next;
+	union {
+		uv_timer_t ev;       // own libuv timer, if !wheel
+		TimerWheelNode node; // link in m_wheel, if wheel
+	};
+	quint64 when;        // nanoseconds, same clock as uv_hrtime()
+	quint64 ns_interval; // interval of a high resolution timer in nanoseconds, 0 otherwise
+	quint64 due;         // deadline computed by calculateNextTimeout(), nanoseconds
+	quint32 serial;      // the registration the slot currently belongs to; 0 once it is released
+	quint32 generation;  // see EventDispatcherLibUvPrivate::nextGeneration()
 	int timerId;
 	int interval;
+	int hires_index;     // position in m_hires_timers while a high resolution timer is armed, -1 otherwise
 	Qt::TimerType type;
+	bool wheel;
+	bool hires;          // driven by the timerfd; ev is initialized but never started
+};
+
+struct SocketNotifierInfo {
+	uv_poll_t ev;
+	EventDispatcherLibUvPrivate* disp;
+	QSocketNotifier* read;
+	QSocketNotifier* write;
+	SocketNotifierInfo* idle_prev; // links in m_idle_notifiers while the descriptor has no enabled notifier
+	SocketNotifierInfo* idle_next;
+	quint64 idle_since;
+	quint32 serial;                // the registration the slot currently belongs to; 0 once it is released
+	int fd;
+	int events;
+	int deferred;
+	int carried;  // events with an activation left in m_event_list by a dispatch budget or an unmasking
+};
+
+// Activation recorded by a libuv callback and delivered by processEvents() once uv_run() returns
+struct PendingEvent {
+	TimerInfo* timer;
+	SocketNotifierInfo* socket;
+	quint32 serial;
+	int events;
+};
+
+struct WorkRequest {
+	uv_work_t req;
+	EventDispatcherLibUvPrivate* disp;
+	EventDispatcherLibUv::Work* work;
+};
+
+struct SignalInfo {
+	uv_signal_t ev;
+	EventDispatcherLibUvPrivate* disp;
+	int signum;
+	int pending;       // received since the last unixSignal() emission
+	quint64 received;
+	quint64 emitted;
+};
+
+// Emits unixSignal() for the signals received during a loop iteration; owned by the dispatcher
+class Q_DECL_HIDDEN SignalTask : public EventDispatcherLibUv::Task {
+public:
+	explicit SignalTask(EventDispatcherLibUvPrivate* d) : EventDispatcherLibUv::Task(), d(d) { this->setAutoDelete(false); }
+	virtual void run(void);
+
+private:
+	EventDispatcherLibUvPrivate* d;
+};
+
+struct LoopHookInfo {
+	union {
+		uv_prepare_t prepare;
+		uv_check_t check;
+		uv_idle_t idle;
+	};
+
+	EventDispatcherLibUvPrivate* disp;
+	EventDispatcherLibUv::LoopHook hook;
+	void* data;
+};
+
+// Receive buffer for the stream classes built on the loop
+struct StreamBuffer {
+	enum { Size = 65536 };
+	char data[Size];
+};
+
+// Keeps up to Cap released receive buffers for reuse and frees the others, so that a burst of connections does not
+// pin a buffer per connection for the lifetime of the dispatcher. Buffers are plain heap objects: one that outlives
+// the cache is freed with delete
+class Q_DECL_HIDDEN StreamBufferCache {
+public:
+	enum { Cap = 16 };
+
+	StreamBufferCache(void) : m_count(0) {}
+
+	~StreamBufferCache(void)
+	{
+		while (this->m_count) {
+			delete this->m_free[--this->m_count];
+		}
+	}
+
+	StreamBuffer* allocate(void)
+	{
+		return this->m_count ? this->m_free[--this->m_count] : new StreamBuffer;
+	}
+
+	void release(StreamBuffer* buffer)
+	{
+		if (this->m_count < Cap) {
+			this->m_free[this->m_count++] = buffer;
+		}
+		else {
+			delete buffer;
+		}
+	}
+
+private:
+	Q_DISABLE_COPY(StreamBufferCache)
+
+	StreamBuffer* m_free[Cap];
+	int m_count;
+};
+
+// An object built on the dispatcher's loop (socket, server, process) that holds handles or buffers of the dispatcher and may
+// outlive it; the dispatcher calls detachFromLoop() before it goes away
+class Q_DECL_HIDDEN LoopClient {
+public:
+	LoopClient(void) : m_client_prev(0), m_client_next(0) {}
+	virtual ~LoopClient(void) {}
+
+	// Closes the handles while the loop is still there and forgets the dispatcher
+	virtual void detachFromLoop(void) = 0;
+
+private:
+	friend class EventDispatcherLibUvPrivate;
+	LoopClient* m_client_prev;
+	LoopClient* m_client_next;
+};
+
+// Bytes [begin, end) of a receive buffer hold data not read yet
+struct ReadChunk {
+	StreamBuffer* buffer;
+	int begin;
+	int end;
+};
+
+Q_DECLARE_TYPEINFO(ReadChunk, Q_PRIMITIVE_TYPE);
+
+// Data received on a stream and not read yet, kept in the receive buffers libuv has read into. Drained buffers go
+// back to the cache; with no cache (the dispatcher has gone away) they are freed
+class Q_DECL_HIDDEN StreamReadBuffer {
+public:
+	// Reads are appended to the last buffer as long as it has at least this much room left
+	enum { MinReadSpace = 4096 };
+
+	StreamReadBuffer(void) : m_chunks(), m_size(0), m_cache(0) {}
+	~StreamReadBuffer(void) { this->clear(); }
+
+	void setCache(StreamBufferCache* cache) { this->m_cache = cache; }
+	qint64 size(void) const { return this->m_size; }
+
+	// For the alloc callback: hands out the free space to read into
+	void reserve(uv_buf_t* buf);
+	// For the read callback: keeps the nread bytes read into the space from reserve(), if any
+	void commit(ssize_t nread);
+
+	bool canReadLine(void) const;
+	qint64 read(char* data, qint64 maxlen);
+	QByteArray readAll(void);
+	void clear(void);
+
+private:
+	Q_DISABLE_COPY(StreamReadBuffer)
+
+	QList<ReadChunk> m_chunks;
+	qint64 m_size;
+	StreamBufferCache* m_cache;
+
+	void release(StreamBuffer* buffer);
+};
+
+struct WriteRequest {
+	uv_write_t req;
+	QList<QByteArray> data; // keeps the buffers alive until libuv is done with them
+	qint64 size;            // bytes left to write when the request was queued
+};
+
+// Limits of one activation source per processEvents() call; 0 means no limit
+struct SourceBudget {
+	quint64 activations;
+	quint64 time;        // ns
 };
 
 struct ZeroTimer {
+	ZeroTimer* prev;
+	ZeroTimer* next;
+	ZeroTimer* obj_prev;
+	ZeroTimer* obj_next;
 	QObject* object;
+	quint64 serial;
+	quint32 generation;
+	int timerId;
 	bool active;
 };
 
+// Heads of the lists of an object's timers
+struct ObjectTimers {
+	TimerInfo* timers;
+	ZeroTimer* zero;
+};
+
+// Position of a processZeroTimers() pass in the zero timer list; passes nest when event handlers reenter the loop
+struct ZeroTimerCursor {
+	ZeroTimer* next;
+	ZeroTimerCursor* outer;
+};
+
 Q_DECLARE_TYPEINFO(TimerInfo, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(SocketNotifierInfo, Q_PRIMITIVE_TYPE);
 Q_DECLARE_TYPEINFO(ZeroTimer, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(PendingEvent, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(WorkRequest, Q_PRIMITIVE_TYPE);
 
-Q_DECL_HIDDEN uint64_t calculateNextTimeout(TimerInfo* info, const struct timeval& now);
-
-class EventDispatcherLibUv;
+Q_DECL_HIDDEN uint64_t calculateNextTimeout(TimerInfo* info, quint64 now);
+Q_DECL_HIDDEN void setSharedTimerGrid(int msec, int slack);
+Q_DECL_HIDDEN int sharedTimerGrid(int* slack);
 
 class Q_DECL_HIDDEN EventDispatcherLibUvPrivate {
 public:
-	EventDispatcherLibUvPrivate(EventDispatcherLibUv* const q);
+	EventDispatcherLibUvPrivate(EventDispatcherLibUv* const q, uv_loop_t* loop = 0);
 	~EventDispatcherLibUvPrivate(void);
 	bool processEvents(QEventLoop::ProcessEventsFlags flags);
 	bool processZeroTimers(void);
 	void registerSocketNotifier(QSocketNotifier* notifier);
 	void unregisterSocketNotifier(QSocketNotifier* notifier);
-	void registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object);
-	void registerZeroTimer(int timerId, QObject* object);
-	bool unregisterTimer(int timerId);
-	bool unregisterTimers(QObject* object);
+	void unregisterSocketNotifier(int sockfd, QSocketNotifier* notifier);
+	void registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object, quint32 generation);
+	void registerZeroTimer(int timerId, QObject* object, quint32 generation);
+	// A non-zero generation spares the timers registered after it was taken, see queueUnregisterTimer()
+	bool unregisterTimer(int timerId, quint32 generation = 0);
+	bool unregisterTimers(QObject* object, quint32 generation = 0);
 	QList<QAbstractEventDispatcher::TimerInfo> registeredTimers(QObject* object) const;
 	int remainingTime(int timerId) const;
+	bool setPreciseTimerInterval(int timerId, qint64 nsec);
+#if QT_VERSION >= 0x040400
+	void postTask(EventDispatcherLibUv::Task* task);
+	void queueRegisterSocketNotifier(QSocketNotifier* notifier);
+	void queueUnregisterSocketNotifier(QSocketNotifier* notifier);
+	void queueRegisterTimer(int timerId, int interval, Qt::TimerType type, QObject* object, quint32 generation);
+	void queueUnregisterTimer(int timerId, quint32 generation);
+	void queueUnregisterTimers(QObject* object, quint32 generation);
+	void queueRemoteWork(EventDispatcherLibUv::Work* work);
+#endif
+	void queueWork(EventDispatcherLibUv::Work* work);
+	static bool setThreadPoolSize(int size);
+	// Must be called before anything is handed to libuv's thread pool (uv_queue_work(), uv_fs_*(), uv_getaddrinfo())
+	static void threadPoolUsed(void);
+	void setHostDriven(bool enable);
+	bool watchSignal(int signum);
+	void unwatchSignal(int signum);
+	int addLoopHook(EventDispatcherLibUv::LoopPhase phase, EventDispatcherLibUv::LoopHook hook, void* data);
+	bool removeLoopHook(int id);
+
+	// For the classes built on the dispatcher's loop; these must be used from the dispatcher's thread.
+	// current() returns the dispatcher of the calling thread, 0 if the thread does not use EventDispatcherLibUv
+	static EventDispatcherLibUvPrivate* current(void)
+	{
+		EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+		return disp ? disp->d_func() : 0;
+	}
 
-	typedef QHash<QSocketNotifier*, uv_poll_t*> SocketNotifierHash;
+	// Every registerTimer() call, from any thread, takes the next generation. A queued unregistration carries
+	// the generation current when it was issued: Qt reuses the timer id as soon as unregisterTimer() returns,
+	// and a newer registration of the same id must survive the command
+	quint32 nextGeneration(void)
+	{
+#if QT_VERSION >= 0x040400
+		quint32 g;
+		do {
+			g = static_cast<quint32>(this->m_generation.fetchAndAddOrdered(1) + 1);
+		} while (Q_UNLIKELY(!g));
+
+		return g;
+#else
+		return 0;
+#endif
+	}
+
+	quint32 currentGeneration(void)
+	{
+#if QT_VERSION >= 0x040400
+		return static_cast<quint32>(this->m_generation.fetchAndAddOrdered(0));
+#else
+		return 0;
+#endif
+	}
+
+	uv_loop_t* loop(void) const { return this->m_base; }
+	void deferTask(EventDispatcherLibUv::Task* task);
+	void requestStarted(void)  { ++this->m_work_count; }
+	// May free a detached dispatcher: nothing may be done with it afterwards
+	void requestFinished(void) { --this->m_work_count; this->reap(); }
+
+	// Host's loop only: closes every handle without running the loop, the object then frees itself
+	// once libuv has run the close callbacks and the requests in flight have completed
+	void detach(void);
+
+	typedef QVector<SocketNotifierInfo*> SocketNotifierTable;
+	typedef QHash<int, SignalInfo*> SignalHash;
+	typedef QHash<int, LoopHookInfo*> LoopHookHash;
 	typedef QHash<int, TimerInfo*> TimerHash;
-	typedef QPair<QPointer<QObject>, QEvent*> PendingEvent;
-	typedef QList<PendingEvent> EventList;
-	typedef QHash<int, ZeroTimer> ZeroTimerHash;
+	typedef QVector<PendingEvent> EventList;
+	typedef QHash<int, ZeroTimer*> ZeroTimerHash;
+	typedef QHash<QObject*, ObjectTimers> ObjectTimerHash;
+	typedef ObjectPool<TimerInfo> TimerPool;
+	typedef ObjectPool<SocketNotifierInfo> SocketNotifierPool;
+	typedef ObjectPool<ZeroTimer> ZeroTimerPool;
+	typedef ObjectPool<WorkRequest> WorkPool;
+
+	StreamBufferCache& streamBuffers(void) { return this->m_stream_buffers; }
+
+	void addClient(LoopClient* client)
+	{
+		client->m_client_prev = 0;
+		client->m_client_next = this->m_clients;
+		if (this->m_clients) {
+			this->m_clients->m_client_prev = client;
+		}
+
+		this->m_clients = client;
+	}
+
+	void removeClient(LoopClient* client)
+	{
+		if (client->m_client_prev) {
+			client->m_client_prev->m_client_next = client->m_client_next;
+		}
+		else {
+			this->m_clients = client->m_client_next;
+		}
+
+		if (client->m_client_next) {
+			client->m_client_next->m_client_prev = client->m_client_prev;
+		}
+
+		client->m_client_prev = 0;
+		client->m_client_next = 0;
+	}
 
 private:
 	Q_DISABLE_COPY(EventDispatcherLibUvPrivate)
 	Q_DECLARE_PUBLIC(EventDispatcherLibUv)
 	EventDispatcherLibUv* const q_ptr;
+	friend class SignalTask;
 
 	bool m_interrupt;
+	int m_loop_level;
+	quint64 m_now;
 	uv_loop_t* m_base;
+	bool m_owns_loop;
+	bool m_host_driven;
+	bool m_nested_warned;
+	bool m_detached;
+	int m_closing;               // handles closed by the dispatcher whose close callbacks have not run yet
+	uv_prepare_t m_pump_prepare; // host driven mode: keeps the host from blocking while Qt has work pending
+	uv_check_t m_pump_check;     // host driven mode: dispatches Qt events after each poll phase
+	uv_idle_t m_pump_idle;
 	uv_async_t m_wakeup;
 #if QT_VERSION >= 0x040400
 	QAtomicInt m_wakeups;
+	QAtomicInt m_generation;
 #endif
-	SocketNotifierHash m_notifiers;
+	SocketNotifierTable m_notifiers;
+	SocketNotifierInfo* m_idle_head;         // stopped watchers kept for the next registration, oldest first
+	SocketNotifierInfo* m_idle_tail;
 	TimerHash m_timers;
 	EventList m_event_list;
+	EventList m_event_spare;
+	EventList m_deferred_notifiers;
+	EventList m_deferred_timers;
+	int m_notifiers_masked;
+	int m_timers_masked;
+	quint32 m_serial;
 	ZeroTimerHash m_zero_timers;
+	ObjectTimerHash m_object_timers;         // unregisterTimers() and registeredTimers() only visit the object's timers
+	ZeroTimer* m_zero_head;
+	ZeroTimer* m_zero_tail;
+	ZeroTimerCursor* m_zero_cursor;
+	quint64 m_zero_serial;
+	uv_idle_t m_zero_idle;
+	bool m_zero_ready;
 	bool m_awaken;
+	TimerPool m_timer_pool;
+	SocketNotifierPool m_notifier_pool;
+	ZeroTimerPool m_zero_pool;
+	TimerWheel* m_wheel;
+	uv_timer_t m_wheel_timer;
+	quint64 m_wheel_due;
+	bool m_wheel_enabled;
+	quint64 m_busy_poll;                     // busy poll budget, ns
+	SourceBudget m_budget[2];                // timers, socket notifiers
+	LoopStatistics m_stats;
+#if QT_VERSION >= 0x040400
+	QAtomicPointer<EventDispatcherLibUv::Task> m_task_stack; // pushed by any thread, newest first
+#endif
+	EventDispatcherLibUv::Task* m_task_head; // taken from m_task_stack, oldest first; dispatcher thread only
+	EventDispatcherLibUv::Task* m_task_tail;
+	WorkPool m_work_pool;
+	EventDispatcherLibUv::Work* m_done_head; // completed work waiting for finish(), oldest first
+	EventDispatcherLibUv::Work* m_done_tail;
+	int m_work_count;                        // requests in the thread pool (work, file system) not yet completed
+	StreamBufferCache m_stream_buffers;
+	LoopClient* m_clients;                   // objects that hold on to the loop, see LoopClient
+	SignalHash m_signals;
+	QVector<SignalInfo*> m_signal_queue;     // received signals waiting for m_signal_task
+	SignalTask m_signal_task;
+	bool m_signal_task_queued;
+	LoopHookHash m_hooks;
+	int m_last_hook_id;
+#ifdef Q_OS_LINUX
+	QVector<TimerInfo*> m_hires_timers;
+	int m_hires_fd;
+	uv_poll_t m_hires_poll;
+	quint64 m_hires_due;
+#endif
 
 	static void socket_notifier_callback(uv_poll_t* w, int status, int events);
+	static void socket_notifier_close_callback(uv_handle_t* w);
+	static void signal_callback(uv_signal_t* w, int signum);
+	static void signal_close_callback(uv_handle_t* w);
 	static void timer_callback(
 		uv_timer_t* w
 #if UV_VERSION_MAJOR < 1
 		, int status
+#endif
+	);
+	static void timer_close_callback(uv_handle_t* w);
+	static void handle_close_callback(uv_handle_t* w);
+	static void wheel_callback(
+		uv_timer_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+#ifdef Q_OS_LINUX
+	static void hires_callback(uv_poll_t* w, int status, int events);
+#endif
+	static void work_callback(uv_work_t* req);
+	static void after_work_callback(uv_work_t* req, int status);
+	static void zero_timer_callback(
+		uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void hook_prepare_callback(
+		uv_prepare_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void hook_check_callback(
+		uv_check_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void hook_idle_callback(
+		uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void hook_close_callback(uv_handle_t* w);
+	static void pump_prepare_callback(
+		uv_prepare_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void pump_check_callback(
+		uv_check_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
+#endif
+	);
+	static void pump_idle_callback(
+		uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+		, int status
 #endif
 	);
 	static void wake_up_handler(
@@ -86,10 +524,81 @@ private:
 #endif
 	);
 
+	// Monotonic time used for all timer calculations, refreshed once per loop iteration
+	void updateTime(bool sync_loop)
+	{
+		if (sync_loop) {
+			uv_update_time(this->m_base);
+		}
+
+		this->m_now = uv_hrtime();
+	}
+
+	void closeHandle(uv_handle_t* handle, uv_close_cb cb)
+	{
+		++this->m_closing;
+		uv_close(handle, cb);
+	}
+
+	void handleClosed(void)
+	{
+		--this->m_closing;
+		this->reap();
+	}
+
+	void reap(void)
+	{
+		if (Q_UNLIKELY(this->m_detached) && !this->m_closing && !this->m_work_count) {
+			delete this;
+		}
+	}
+
+	quint32 nextSerial(void)
+	{
+		if (Q_UNLIKELY(!++this->m_serial)) {
+			++this->m_serial;
+		}
+
+		return this->m_serial;
+	}
+
+	void killHandles(void);
+	void closeHandles(void);
+	void detachClients(void);
+	bool deliverEvent(const PendingEvent& e);
+	bool busyPoll(void);
+	void takeTasks(void);
+	bool runTasks(void);
+	void discardTasks(void);
+	bool finishWork(void);
+	void deferSocketEvent(SocketNotifierInfo* info, int events);
+
 	bool disableSocketNotifiers(bool disable);
 	void killSocketNotifiers(void);
+	void releaseSocketNotifier(SocketNotifierInfo* info);
+	void unlinkIdleNotifier(SocketNotifierInfo* info);
+	void releaseIdleNotifiers(quint64 now);
+	void deliverSignals(void);
+	void killSignals(void);
+	void killLoopHooks(void);
+	void armTimer(TimerInfo* info, uint64_t delta);
+	bool isTimerArmed(const TimerInfo* info) const;
+	void timerExpired(TimerInfo* info);
+	void scheduleWheel(void);
+#ifdef Q_OS_LINUX
+	bool initHiResTimers(void);
+	void armHiResTimer(TimerInfo* info);
+	void disarmHiResTimer(TimerInfo* info);
+	void scheduleHiRes(void);
+#endif
 	bool disableTimers(bool disable);
 	void killTimers(void);
+	void releaseTimer(TimerInfo* info);
+	void releaseZeroTimer(ZeroTimer* timer);
+	void linkTimer(TimerInfo* info);
+	void unlinkTimer(TimerInfo* info);
+	void linkZeroTimer(ZeroTimer* timer);
+	void unlinkZeroTimer(ZeroTimer* timer);
 };
 
 #endif // EVENTDISPATCHER_LIBUV_P_H
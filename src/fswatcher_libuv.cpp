@@ -0,0 +1,77 @@
+#include "fswatcher_libuv.h"
+#include "fswatcher_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+FileSystemWatcherLibUv::FileSystemWatcherLibUv(QObject* parent)
+	: QObject(parent), d_ptr(new FileSystemWatcherLibUvPrivate(this))
+{
+}
+
+FileSystemWatcherLibUv::~FileSystemWatcherLibUv(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+bool FileSystemWatcherLibUv::addPath(const QString& path)
+{
+	Q_D(FileSystemWatcherLibUv);
+	return d->addPath(path);
+}
+
+QStringList FileSystemWatcherLibUv::addPaths(const QStringList& paths)
+{
+	Q_D(FileSystemWatcherLibUv);
+
+	QStringList failed;
+	for (int i=0; i<paths.size(); ++i) {
+		if (!d->addPath(paths.at(i))) {
+			failed.append(paths.at(i));
+		}
+	}
+
+	return failed;
+}
+
+bool FileSystemWatcherLibUv::removePath(const QString& path)
+{
+	Q_D(FileSystemWatcherLibUv);
+	return d->removePath(path);
+}
+
+QStringList FileSystemWatcherLibUv::removePaths(const QStringList& paths)
+{
+	Q_D(FileSystemWatcherLibUv);
+
+	QStringList failed;
+	for (int i=0; i<paths.size(); ++i) {
+		if (!d->removePath(paths.at(i))) {
+			failed.append(paths.at(i));
+		}
+	}
+
+	return failed;
+}
+
+QStringList FileSystemWatcherLibUv::paths(void) const
+{
+	Q_D(const FileSystemWatcherLibUv);
+	return d->m_entries.keys();
+}
+
+void FileSystemWatcherLibUv::setCoalescingWindow(int msec)
+{
+	Q_D(FileSystemWatcherLibUv);
+	d->m_window = qMax(msec, 0);
+}
+
+int FileSystemWatcherLibUv::coalescingWindow(void) const
+{
+	Q_D(const FileSystemWatcherLibUv);
+	return d->m_window;
+}
+
+#endif // UV_VERSION_MAJOR >= 1
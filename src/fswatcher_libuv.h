@@ -0,0 +1,50 @@
+#ifndef FSWATCHER_LIBUV_H
+#define FSWATCHER_LIBUV_H
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+class FileSystemWatcherLibUvPrivate;
+
+/*
+ * Watches files and directories with one uv_fs_event_t per path on the loop of the thread's EventDispatcherLibUv
+ * (on Linux libuv shares a single inotify descriptor among all of them). Changes are collected for the coalescing
+ * window and delivered as one list of distinct paths: the watched file itself, or the changed entry of a watched
+ * directory. All functions must be called from the dispatcher's thread. Error codes are negative libuv error codes.
+ * Requires libuv 1.0+.
+ */
+class FileSystemWatcherLibUv : public QObject {
+	Q_OBJECT
+public:
+	explicit FileSystemWatcherLibUv(QObject* parent = 0);
+	virtual ~FileSystemWatcherLibUv(void);
+
+	bool addPath(const QString& path);
+	// Returns the paths that could not be added
+	QStringList addPaths(const QStringList& paths);
+	bool removePath(const QString& path);
+	// Returns the paths that were not watched
+	QStringList removePaths(const QStringList& paths);
+	QStringList paths(void) const;
+
+	// Changes are delivered msec milliseconds after the first one; with 0 (the default) they are delivered
+	// at the end of the loop iteration that reported them
+	void setCoalescingWindow(int msec);
+	int coalescingWindow(void) const;
+
+Q_SIGNALS:
+	void pathsChanged(const QStringList& paths);
+	void errorOccurred(const QString& path, int error);
+
+private:
+	Q_DISABLE_COPY(FileSystemWatcherLibUv)
+	Q_DECLARE_PRIVATE(FileSystemWatcherLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<FileSystemWatcherLibUvPrivate> d_ptr;
+#else
+	FileSystemWatcherLibUvPrivate* d_ptr;
+#endif
+};
+
+#endif // FSWATCHER_LIBUV_H
@@ -0,0 +1,190 @@
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include "fswatcher_libuv.h"
+#include "fswatcher_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+namespace {
+
+	void close_entry(uv_handle_t* handle)
+	{
+		delete static_cast<WatchEntry*>(handle->data);
+	}
+
+	void close_timer(uv_handle_t* handle)
+	{
+		delete reinterpret_cast<uv_timer_t*>(handle);
+	}
+
+}
+
+void FileSystemWatcherNotifyTask::run(void)
+{
+	if (this->d) {
+		this->d->m_notify = 0;
+		this->d->notify();
+	}
+}
+
+FileSystemWatcherLibUvPrivate::FileSystemWatcherLibUvPrivate(FileSystemWatcherLibUv* const q)
+	: q_ptr(q), m_disp(0), m_entries(), m_window_timer(0), m_notify(0), m_window(0), m_changed(), m_changed_set(), m_errors()
+{
+}
+
+FileSystemWatcherLibUvPrivate::~FileSystemWatcherLibUvPrivate(void)
+{
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+	}
+
+	QHash<QString, WatchEntry*>::ConstIterator it = this->m_entries.constBegin();
+	while (it != this->m_entries.constEnd()) {
+		uv_close(reinterpret_cast<uv_handle_t*>(&it.value()->handle), close_entry);
+		++it;
+	}
+
+	if (this->m_window_timer) {
+		this->m_window_timer->data = 0;
+		uv_close(reinterpret_cast<uv_handle_t*>(this->m_window_timer), close_timer);
+	}
+}
+
+bool FileSystemWatcherLibUvPrivate::addPath(const QString& path)
+{
+	if (path.isEmpty() || this->m_entries.contains(path)) {
+		return false;
+	}
+
+	if (!this->m_disp) {
+		this->m_disp = EventDispatcherLibUvPrivate::current();
+		if (!this->m_disp) {
+			qWarning("FileSystemWatcherLibUv: the thread does not run EventDispatcherLibUv");
+			return false;
+		}
+	}
+
+	WatchEntry* entry  = new WatchEntry;
+	entry->watcher     = this;
+	entry->path        = path;
+	entry->dir         = QFileInfo(path).isDir();
+	uv_fs_event_init(this->m_disp->loop(), &entry->handle);
+	entry->handle.data = entry;
+
+	int rc = uv_fs_event_start(&entry->handle, &FileSystemWatcherLibUvPrivate::fs_event_callback, QFile::encodeName(path).constData(), 0);
+	if (rc < 0) {
+		uv_close(reinterpret_cast<uv_handle_t*>(&entry->handle), close_entry);
+		return false;
+	}
+
+	this->m_entries.insert(path, entry);
+	return true;
+}
+
+bool FileSystemWatcherLibUvPrivate::removePath(const QString& path)
+{
+	WatchEntry* entry = this->m_entries.take(path);
+	if (!entry) {
+		return false;
+	}
+
+	uv_close(reinterpret_cast<uv_handle_t*>(&entry->handle), close_entry);
+	return true;
+}
+
+void FileSystemWatcherLibUvPrivate::changed(const QString& path)
+{
+	if (this->m_changed_set.contains(path)) {
+		return;
+	}
+
+	this->m_changed_set.insert(path);
+	this->m_changed.append(path);
+
+	if (!this->m_window) {
+		this->schedule();
+		return;
+	}
+
+	if (!this->m_window_timer) {
+		this->m_window_timer = new uv_timer_t;
+		uv_timer_init(this->m_disp->loop(), this->m_window_timer);
+		this->m_window_timer->data = this;
+	}
+
+	// The window opens with the first change and is not extended by the following ones
+	if (!uv_is_active(reinterpret_cast<uv_handle_t*>(this->m_window_timer))) {
+		uv_timer_start(this->m_window_timer, &FileSystemWatcherLibUvPrivate::window_callback, static_cast<uint64_t>(this->m_window), 0);
+	}
+}
+
+void FileSystemWatcherLibUvPrivate::schedule(void)
+{
+	if (!this->m_notify) {
+		this->m_notify = new FileSystemWatcherNotifyTask(this);
+		this->m_disp->deferTask(this->m_notify);
+	}
+}
+
+void FileSystemWatcherLibUvPrivate::notify(void)
+{
+	Q_Q(FileSystemWatcherLibUv);
+
+	QList<QPair<QString, int> > errors = this->m_errors;
+	this->m_errors.clear();
+
+	// Changes still inside the coalescing window are left for the timer
+	QStringList changed;
+	if (!this->m_window_timer || !uv_is_active(reinterpret_cast<uv_handle_t*>(this->m_window_timer))) {
+		changed = this->m_changed;
+		this->m_changed.clear();
+		this->m_changed_set.clear();
+	}
+
+	// Any slot may destroy the watcher
+	QPointer<FileSystemWatcherLibUv> guard(q);
+
+	for (int i=0; i<errors.size(); ++i) {
+		Q_EMIT q->errorOccurred(errors.at(i).first, errors.at(i).second);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (!changed.isEmpty()) {
+		Q_EMIT q->pathsChanged(changed);
+	}
+}
+
+void FileSystemWatcherLibUvPrivate::fs_event_callback(uv_fs_event_t* handle, const char* filename, int events, int status)
+{
+	Q_UNUSED(events)
+
+	WatchEntry* entry                = static_cast<WatchEntry*>(handle->data);
+	FileSystemWatcherLibUvPrivate* d = entry->watcher;
+
+	if (status < 0) {
+		d->m_errors.append(qMakePair(entry->path, status));
+		d->schedule();
+		return;
+	}
+
+	if (entry->dir && filename && *filename) {
+		QString name = QFile::decodeName(filename);
+		d->changed(entry->path.endsWith(QLatin1Char('/')) ? entry->path + name : entry->path + QLatin1Char('/') + name);
+	}
+	else {
+		d->changed(entry->path);
+	}
+}
+
+void FileSystemWatcherLibUvPrivate::window_callback(uv_timer_t* handle)
+{
+	FileSystemWatcherLibUvPrivate* d = static_cast<FileSystemWatcherLibUvPrivate*>(handle->data);
+	if (d) {
+		d->schedule();
+	}
+}
+
+#endif // UV_VERSION_MAJOR >= 1
@@ -0,0 +1,66 @@
+#ifndef FSWATCHER_LIBUV_P_H
+#define FSWATCHER_LIBUV_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <uv.h>
+#include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+#include "eventdispatcher_libuv_p.h"
+
+class FileSystemWatcherLibUv;
+class FileSystemWatcherLibUvPrivate;
+
+struct Q_DECL_HIDDEN WatchEntry {
+	uv_fs_event_t handle;
+	FileSystemWatcherLibUvPrivate* watcher;
+	QString path;
+	bool dir;    // changes are reported for the entries of the directory
+};
+
+class Q_DECL_HIDDEN FileSystemWatcherNotifyTask : public EventDispatcherLibUv::Task {
+public:
+	explicit FileSystemWatcherNotifyTask(FileSystemWatcherLibUvPrivate* d) : EventDispatcherLibUv::Task(), d(d) {}
+	virtual void run(void);
+
+	FileSystemWatcherLibUvPrivate* d;
+};
+
+class Q_DECL_HIDDEN FileSystemWatcherLibUvPrivate {
+public:
+	FileSystemWatcherLibUvPrivate(FileSystemWatcherLibUv* const q);
+	~FileSystemWatcherLibUvPrivate(void);
+
+	bool addPath(const QString& path);
+	bool removePath(const QString& path);
+	void notify(void);
+
+private:
+	Q_DISABLE_COPY(FileSystemWatcherLibUvPrivate)
+	Q_DECLARE_PUBLIC(FileSystemWatcherLibUv)
+	FileSystemWatcherLibUv* const q_ptr;
+
+	EventDispatcherLibUvPrivate* m_disp;
+	QHash<QString, WatchEntry*> m_entries;
+	uv_timer_t* m_window_timer;          // running while a coalescing window is open
+	FileSystemWatcherNotifyTask* m_notify;
+	int m_window;
+	QStringList m_changed;               // in the order of the first change
+	QSet<QString> m_changed_set;
+	QList<QPair<QString, int> > m_errors;
+
+	void changed(const QString& path);
+	void schedule(void);
+
+	static void fs_event_callback(uv_fs_event_t* handle, const char* filename, int events, int status);
+	static void window_callback(uv_timer_t* handle);
+
+	friend class FileSystemWatcherNotifyTask;
+	friend class FileSystemWatcherLibUv;
+};
+
+#endif // FSWATCHER_LIBUV_P_H
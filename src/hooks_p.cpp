@@ -0,0 +1,117 @@
+#include "eventdispatcher_libuv_p.h"
+
+/*
+ * Each hook has its own unreferenced handle: hooks never keep the loop alive, and the cost of an installed hook
+ * is that of the libuv handle (a queue walk per phase), with no signal emission involved.
+ */
+int EventDispatcherLibUvPrivate::addLoopHook(EventDispatcherLibUv::LoopPhase phase, EventDispatcherLibUv::LoopHook hook, void* data)
+{
+	if (!hook) {
+		return 0;
+	}
+
+	LoopHookInfo* info = new LoopHookInfo;
+	info->disp         = this;
+	info->hook         = hook;
+	info->data         = data;
+
+	switch (phase) {
+		case EventDispatcherLibUv::BeforePoll:
+			uv_prepare_init(this->m_base, &info->prepare);
+			uv_prepare_start(&info->prepare, &EventDispatcherLibUvPrivate::hook_prepare_callback);
+			break;
+
+		case EventDispatcherLibUv::AfterPoll:
+			uv_check_init(this->m_base, &info->check);
+			uv_check_start(&info->check, &EventDispatcherLibUvPrivate::hook_check_callback);
+			break;
+
+		case EventDispatcherLibUv::Idle:
+			uv_idle_init(this->m_base, &info->idle);
+			uv_idle_start(&info->idle, &EventDispatcherLibUvPrivate::hook_idle_callback);
+			break;
+
+		default:
+			Q_ASSERT(false);
+			delete info;
+			return 0;
+	}
+
+	uv_handle_t* h = reinterpret_cast<uv_handle_t*>(&info->prepare);
+	h->data        = info;
+	uv_unref(h);
+
+	// Ids are not reused until the counter wraps around
+	do {
+		if (Q_UNLIKELY(++this->m_last_hook_id <= 0)) {
+			this->m_last_hook_id = 1;
+		}
+	} while (this->m_hooks.contains(this->m_last_hook_id));
+
+	this->m_hooks.insert(this->m_last_hook_id, info);
+	return this->m_last_hook_id;
+}
+
+bool EventDispatcherLibUvPrivate::removeLoopHook(int id)
+{
+	LoopHookInfo* info = this->m_hooks.take(id);
+	if (!info) {
+		return false;
+	}
+
+	// Safe from within the hook itself: libuv does not call a closing handle's callback again
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&info->prepare), &EventDispatcherLibUvPrivate::hook_close_callback);
+	return true;
+}
+
+void EventDispatcherLibUvPrivate::killLoopHooks(void)
+{
+	LoopHookHash::ConstIterator it = this->m_hooks.constBegin();
+	while (it != this->m_hooks.constEnd()) {
+		this->closeHandle(reinterpret_cast<uv_handle_t*>(&it.value()->prepare), &EventDispatcherLibUvPrivate::hook_close_callback);
+		++it;
+	}
+
+	this->m_hooks.clear();
+}
+
+void EventDispatcherLibUvPrivate::hook_prepare_callback(
+	uv_prepare_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	LoopHookInfo* info = static_cast<LoopHookInfo*>(w->data);
+	info->hook(info->data);
+}
+
+void EventDispatcherLibUvPrivate::hook_check_callback(
+	uv_check_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	LoopHookInfo* info = static_cast<LoopHookInfo*>(w->data);
+	info->hook(info->data);
+}
+
+void EventDispatcherLibUvPrivate::hook_idle_callback(
+	uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	LoopHookInfo* info = static_cast<LoopHookInfo*>(w->data);
+	info->hook(info->data);
+}
+
+void EventDispatcherLibUvPrivate::hook_close_callback(uv_handle_t* w)
+{
+	LoopHookInfo* info                = static_cast<LoopHookInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+	delete info;
+	disp->handleClosed();
+}
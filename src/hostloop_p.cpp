@@ -0,0 +1,68 @@
+#include "eventdispatcher_libuv_p.h"
+
+/*
+ * In host driven mode the loop's owner calls uv_run() and Qt never does. Libuv callbacks collect activations
+ * as usual; the check handle, which runs right after the poll phase, delivers them with a non-blocking
+ * processEvents() pass. The prepare handle, which runs right before the poll phase, keeps the host from blocking
+ * while Qt has work pending. The wake up handle is unreferenced so that it does not keep the host's loop alive.
+ */
+void EventDispatcherLibUvPrivate::setHostDriven(bool enable)
+{
+	if (enable == this->m_host_driven) {
+		return;
+	}
+
+	this->m_host_driven = enable;
+	if (enable) {
+		uv_prepare_start(&this->m_pump_prepare, &EventDispatcherLibUvPrivate::pump_prepare_callback);
+		uv_check_start(&this->m_pump_check, &EventDispatcherLibUvPrivate::pump_check_callback);
+		uv_unref(reinterpret_cast<uv_handle_t*>(&this->m_wakeup));
+	}
+	else {
+		uv_prepare_stop(&this->m_pump_prepare);
+		uv_check_stop(&this->m_pump_check);
+		uv_idle_stop(&this->m_pump_idle);
+		uv_ref(reinterpret_cast<uv_handle_t*>(&this->m_wakeup));
+	}
+}
+
+void EventDispatcherLibUvPrivate::pump_prepare_callback(
+	uv_prepare_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->data);
+	EventDispatcherLibUv* q           = disp->q_func();
+
+	// An active idle handle makes the poll phase return immediately
+	if (q->hasPendingEvents() || !disp->m_event_list.isEmpty() || disp->m_task_head || disp->m_done_head) {
+		uv_idle_start(&disp->m_pump_idle, &EventDispatcherLibUvPrivate::pump_idle_callback);
+	}
+	else {
+		uv_idle_stop(&disp->m_pump_idle);
+		Q_EMIT q->aboutToBlock();
+	}
+}
+
+void EventDispatcherLibUvPrivate::pump_check_callback(
+	uv_check_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->data);
+	disp->processEvents(QEventLoop::AllEvents);
+}
+
+void EventDispatcherLibUvPrivate::pump_idle_callback(
+	uv_idle_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	Q_UNUSED(w)
+}
@@ -0,0 +1,166 @@
+#include <QtCore/QtGlobal>
+#include <limits.h>
+#ifdef Q_OS_LINUX
+#	include <sys/timerfd.h>
+#	include <errno.h>
+#	include <string.h>
+#	include <unistd.h>
+#endif
+#include "eventdispatcher_libuv_p.h"
+
+namespace {
+
+	static const quint64 NSEC_PER_MSEC = Q_UINT64_C(1000000);
+#ifdef Q_OS_LINUX
+	static const quint64 NSEC_PER_SEC  = Q_UINT64_C(1000000000);
+#endif
+
+}
+
+bool EventDispatcherLibUvPrivate::setPreciseTimerInterval(int timerId, qint64 nsec)
+{
+	TimerHash::ConstIterator it = this->m_timers.constFind(timerId);
+	if (it == this->m_timers.constEnd() || nsec <= 0) {
+		return false;
+	}
+
+	TimerInfo* info = it.value();
+	if (Qt::PreciseTimer != info->type) {
+		return false;
+	}
+
+	Q_ASSERT(!info->wheel);
+
+	// Stop the timer wherever it runs now; a new serial drops the activations queued for the old schedule
+#ifdef Q_OS_LINUX
+	if (info->hires) {
+		this->disarmHiResTimer(info);
+	}
+	else
+#endif
+	{
+		uv_timer_stop(&info->ev);
+	}
+
+	info->serial   = this->nextSerial();
+	info->interval = static_cast<int>(qMin<quint64>((static_cast<quint64>(nsec) + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC, INT_MAX));
+
+#ifdef Q_OS_LINUX
+	if (-1 != this->m_hires_fd || this->initHiResTimers()) {
+		info->ns_interval = static_cast<quint64>(nsec);
+		info->hires       = true;
+	}
+#endif
+
+	// The timerfd deadline is absolute: inside processEvents() the cached time is as old as the last uv_run(),
+	// a deadline computed from it would fire early. Elsewhere the cached time may be arbitrarily old
+	if (info->hires || !this->m_loop_level) {
+		this->updateTime(true);
+	}
+
+	// Without timerfd the interval is rounded up to whole milliseconds
+	info->when     = this->m_now;
+	uint64_t delta = calculateNextTimeout(info, this->m_now);
+	this->armTimer(info, delta);
+	return true;
+}
+
+#ifdef Q_OS_LINUX
+
+bool EventDispatcherLibUvPrivate::initHiResTimers(void)
+{
+	// uv_hrtime() reads CLOCK_MONOTONIC on Linux, thus TimerInfo::when can be used as an absolute expiration time
+	this->m_hires_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (-1 == this->m_hires_fd) {
+		qWarning("%s: timerfd_create() failed: %s", Q_FUNC_INFO, strerror(errno));
+		return false;
+	}
+
+	uv_poll_init(this->m_base, &this->m_hires_poll, this->m_hires_fd);
+	this->m_hires_poll.data = this;
+	uv_poll_start(&this->m_hires_poll, UV_READABLE, &EventDispatcherLibUvPrivate::hires_callback);
+	// The descriptor alone must not keep the loop alive
+	uv_unref(reinterpret_cast<uv_handle_t*>(&this->m_hires_poll));
+	return true;
+}
+
+void EventDispatcherLibUvPrivate::armHiResTimer(TimerInfo* info)
+{
+	if (info->hires_index < 0) {
+		info->hires_index = this->m_hires_timers.size();
+		this->m_hires_timers.append(info);
+	}
+
+	if (!this->m_hires_due || info->when < this->m_hires_due) {
+		this->scheduleHiRes();
+	}
+}
+
+void EventDispatcherLibUvPrivate::disarmHiResTimer(TimerInfo* info)
+{
+	// If the timer was the earliest one, the descriptor fires once more for nothing, which is harmless
+	int idx = info->hires_index;
+	if (idx >= 0) {
+		TimerInfo* last = this->m_hires_timers.last();
+		this->m_hires_timers[idx] = last;
+		last->hires_index         = idx;
+		this->m_hires_timers.removeLast();
+		info->hires_index = -1;
+	}
+}
+
+void EventDispatcherLibUvPrivate::scheduleHiRes(void)
+{
+	// There are only a few sub-millisecond timers, a linear scan is cheaper than maintaining a heap
+	quint64 due = 0;
+	for (int i=0; i<this->m_hires_timers.size(); ++i) {
+		quint64 when = this->m_hires_timers.at(i)->when;
+		if (!due || when < due) {
+			due = when;
+		}
+	}
+
+	// All-zero it_value disarms the descriptor; a deadline in the past makes it fire immediately
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+	spec.it_value.tv_sec  = static_cast<time_t>(due / NSEC_PER_SEC);
+	spec.it_value.tv_nsec = static_cast<long>(due % NSEC_PER_SEC);
+
+	if (-1 == timerfd_settime(this->m_hires_fd, TFD_TIMER_ABSTIME, &spec, 0)) {
+		qWarning("%s: timerfd_settime() failed: %s", Q_FUNC_INFO, strerror(errno));
+	}
+
+	this->m_hires_due = due;
+}
+
+void EventDispatcherLibUvPrivate::hires_callback(uv_poll_t* w, int status, int events)
+{
+	Q_UNUSED(status)
+	Q_UNUSED(events)
+
+	EventDispatcherLibUvPrivate* self = static_cast<EventDispatcherLibUvPrivate*>(w->data);
+
+	uint64_t expirations;
+	while (-1 == read(self->m_hires_fd, &expirations, sizeof(expirations)) && EINTR == errno) {
+	}
+
+	self->m_hires_due = 0;
+
+	const quint64 now = uv_hrtime();
+	int i = 0;
+	while (i < self->m_hires_timers.size()) {
+		TimerInfo* info = self->m_hires_timers.at(i);
+		if (info->when <= now) {
+			// Moves the last timer to position i
+			self->disarmHiResTimer(info);
+			self->timerExpired(info);
+		}
+		else {
+			++i;
+		}
+	}
+
+	self->scheduleHiRes();
+}
+
+#endif // Q_OS_LINUX
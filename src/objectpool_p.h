@@ -0,0 +1,104 @@
+#ifndef OBJECTPOOL_P_H
+#define OBJECTPOOL_P_H
+
+#include <new>
+#include <stdlib.h>
+#include <QtCore/QVector>
+#include "qt4compat.h"
+
+/*
+ * Free list allocator for the objects the dispatcher creates and destroys on its hot paths
+ * (timers, poll handles). Memory is obtained in chunks of ChunkSize slots, every slot is aligned
+ * to a cache line boundary, and released slots are recycled; chunks are returned to the system
+ * only when the pool itself is destroyed. Thus a pointer to a released object always points
+ * to valid (although possibly reused) memory while the pool is alive; release() overwrites
+ * only the first sizeof(void*) bytes of the object.
+ *
+ * The pool is not thread safe: it is used only from the thread the dispatcher belongs to.
+ */
+template<typename T, int ChunkSize = 64>
+class Q_DECL_HIDDEN ObjectPool {
+public:
+	enum { CacheLineSize = 64 };
+
+	ObjectPool(void) : m_free(0), m_chunks(), m_capacity(0), m_used(0), m_hwm(0) {}
+
+	~ObjectPool(void)
+	{
+		for (int i=0; i<this->m_chunks.size(); ++i) {
+			free(this->m_chunks.at(i));
+		}
+	}
+
+	T* allocate(void)
+	{
+		if (Q_UNLIKELY(!this->m_free)) {
+			this->grow();
+		}
+
+		Slot* slot   = this->m_free;
+		this->m_free = slot->next;
+
+		++this->m_used;
+		if (this->m_used > this->m_hwm) {
+			this->m_hwm = this->m_used;
+		}
+
+		return new(slot) T;
+	}
+
+	void release(T* p)
+	{
+		Q_ASSERT(p != 0);
+		Q_ASSERT(this->m_used > 0);
+
+		p->~T();
+		Slot* slot   = reinterpret_cast<Slot*>(p);
+		slot->next   = this->m_free;
+		this->m_free = slot;
+		--this->m_used;
+	}
+
+	int capacity(void) const      { return this->m_capacity; }
+	int used(void) const          { return this->m_used; }
+	int highWaterMark(void) const { return this->m_hwm; }
+
+private:
+	Q_DISABLE_COPY(ObjectPool)
+
+	struct Slot {
+		Slot* next;
+	};
+
+	enum {
+		RawSize  = sizeof(T) > sizeof(Slot) ? sizeof(T) : sizeof(Slot),
+		SlotSize = ((RawSize + CacheLineSize - 1) / CacheLineSize) * CacheLineSize
+	};
+
+	Slot* m_free;
+	QVector<void*> m_chunks;
+	int m_capacity;
+	int m_used;
+	int m_hwm;
+
+	void grow(void)
+	{
+		void* chunk = malloc(SlotSize * ChunkSize + CacheLineSize - 1);
+		if (Q_UNLIKELY(!chunk)) {
+			qFatal("%s: out of memory", Q_FUNC_INFO);
+		}
+
+		this->m_chunks.append(chunk);
+
+		quintptr base = (reinterpret_cast<quintptr>(chunk) + CacheLineSize - 1) & ~quintptr(CacheLineSize - 1);
+		for (int i=ChunkSize-1; i>=0; --i) {
+			Slot* slot   = reinterpret_cast<Slot*>(base + i * SlotSize);
+			slot->next   = this->m_free;
+			this->m_free = slot;
+		}
+
+		this->m_capacity += ChunkSize;
+	}
+};
+
+#endif // OBJECTPOOL_P_H
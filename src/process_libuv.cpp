@@ -0,0 +1,121 @@
+#include "process_libuv.h"
+#include "process_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+ProcessLibUv::ProcessLibUv(QObject* parent)
+	: QObject(parent), d_ptr(new ProcessLibUvPrivate(this))
+{
+}
+
+ProcessLibUv::~ProcessLibUv(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+void ProcessLibUv::setWorkingDirectory(const QString& dir)
+{
+	Q_D(ProcessLibUv);
+	d->m_cwd = dir;
+}
+
+QString ProcessLibUv::workingDirectory(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_cwd;
+}
+
+void ProcessLibUv::setEnvironment(const QStringList& environment)
+{
+	Q_D(ProcessLibUv);
+	d->m_env = environment;
+}
+
+QStringList ProcessLibUv::environment(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_env;
+}
+
+bool ProcessLibUv::start(const QString& program, const QStringList& arguments)
+{
+	Q_D(ProcessLibUv);
+	return d->start(program, arguments);
+}
+
+bool ProcessLibUv::kill(int signum)
+{
+	Q_D(ProcessLibUv);
+	return d->kill(signum);
+}
+
+ProcessLibUv::ProcessState ProcessLibUv::state(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_pid ? Running : NotRunning;
+}
+
+qint64 ProcessLibUv::pid(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_pid;
+}
+
+int ProcessLibUv::error(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_error;
+}
+
+qint64 ProcessLibUv::exitCode(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_exit_code;
+}
+
+int ProcessLibUv::exitSignal(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_exit_signal;
+}
+
+qint64 ProcessLibUv::write(const QByteArray& data)
+{
+	Q_D(ProcessLibUv);
+	return d->write(data);
+}
+
+qint64 ProcessLibUv::bytesToWrite(void) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_to_write;
+}
+
+void ProcessLibUv::closeWriteChannel(void)
+{
+	Q_D(ProcessLibUv);
+	d->closeWriteChannel();
+}
+
+qint64 ProcessLibUv::bytesAvailable(ProcessChannel channel) const
+{
+	Q_D(const ProcessLibUv);
+	return d->m_buffers[channel].size();
+}
+
+QByteArray ProcessLibUv::readAllStandardOutput(void)
+{
+	Q_D(ProcessLibUv);
+	return d->readAll(StandardOutput);
+}
+
+QByteArray ProcessLibUv::readAllStandardError(void)
+{
+	Q_D(ProcessLibUv);
+	return d->readAll(StandardError);
+}
+
+#endif // UV_VERSION_MAJOR >= 1
@@ -0,0 +1,79 @@
+#ifndef PROCESS_LIBUV_H
+#define PROCESS_LIBUV_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+class ProcessLibUvPrivate;
+
+/*
+ * Child process started with uv_spawn() on the loop of the thread's EventDispatcherLibUv. The standard streams are
+ * libuv pipes: output is read into pooled buffers, input is written with uv_write(), and the exit status is reported
+ * by libuv's own SIGCHLD handling, so no helper thread or socket notifiers are involved. finished() is emitted once
+ * the process has exited and both output channels have reached end of file. Signals are emitted from the event loop.
+ * Error codes are negative libuv error codes. Requires libuv 1.0+.
+ */
+class ProcessLibUv : public QObject {
+	Q_OBJECT
+public:
+	enum ProcessState {
+		NotRunning,
+		Running
+	};
+
+	enum ProcessChannel {
+		StandardOutput,
+		StandardError
+	};
+
+	explicit ProcessLibUv(QObject* parent = 0);
+	// A process still running is killed with SIGKILL; libuv reaps it later
+	virtual ~ProcessLibUv(void);
+
+	void setWorkingDirectory(const QString& dir);
+	QString workingDirectory(void) const;
+	// "NAME=value" entries; an empty list (the default) inherits the environment of the calling process
+	void setEnvironment(const QStringList& environment);
+	QStringList environment(void) const;
+
+	// program is looked up in PATH if it does not contain a slash
+	bool start(const QString& program, const QStringList& arguments = QStringList());
+	bool kill(int signum);
+
+	ProcessState state(void) const;
+	qint64 pid(void) const;
+	int error(void) const;
+	qint64 exitCode(void) const;
+	// The signal that terminated the process, 0 if it exited normally
+	int exitSignal(void) const;
+
+	qint64 write(const QByteArray& data);
+	qint64 bytesToWrite(void) const;
+	// Closes the child's standard input once the queued data has been written
+	void closeWriteChannel(void);
+
+	qint64 bytesAvailable(ProcessChannel channel) const;
+	QByteArray readAllStandardOutput(void);
+	QByteArray readAllStandardError(void);
+
+Q_SIGNALS:
+	void started(void);
+	void readyReadStandardOutput(void);
+	void readyReadStandardError(void);
+	void bytesWritten(qint64 bytes);
+	void finished(qint64 exitCode, int exitSignal);
+	void errorOccurred(int error);
+
+private:
+	Q_DISABLE_COPY(ProcessLibUv)
+	Q_DECLARE_PRIVATE(ProcessLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<ProcessLibUvPrivate> d_ptr;
+#else
+	ProcessLibUvPrivate* d_ptr;
+#endif
+};
+
+#endif // PROCESS_LIBUV_H
@@ -0,0 +1,425 @@
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QVarLengthArray>
+#include <string.h>
+#include "process_libuv.h"
+#include "process_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+namespace {
+
+	void close_pipe(uv_handle_t* handle)
+	{
+		delete static_cast<ProcessPipe*>(handle->data);
+	}
+
+	void close_process(uv_handle_t* handle)
+	{
+		delete reinterpret_cast<uv_process_t*>(handle);
+	}
+
+}
+
+void ProcessNotifyTask::run(void)
+{
+	if (this->d) {
+		this->d->m_notify = 0;
+		this->d->notify();
+	}
+}
+
+ProcessLibUvPrivate::ProcessLibUvPrivate(ProcessLibUv* const q)
+	: q_ptr(q), m_disp(0), m_process(0), m_stdin(0), m_notify(0), m_cwd(), m_env(), m_pid(0), m_error(0), m_events(0),
+	  m_exit_code(0), m_exit_signal(0), m_exited(false), m_close_stdin(false), m_to_write(0), m_written(0), m_writes_in_flight(0)
+{
+	this->m_output[0] = 0;
+	this->m_output[1] = 0;
+}
+
+ProcessLibUvPrivate::~ProcessLibUvPrivate(void)
+{
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+	}
+
+	if (this->m_process) {
+		// The exit callback closes the orphaned handle
+		uv_process_kill(this->m_process, SIGKILL);
+		this->m_process->data = 0;
+		this->m_process       = 0;
+	}
+
+	this->releaseAll();
+	this->clearReadBuffers();
+
+	if (this->m_disp) {
+		this->m_disp->removeClient(this);
+	}
+}
+
+void ProcessLibUvPrivate::detachFromLoop(void)
+{
+	// The dispatcher is being destroyed: the child is killed, the output read so far can still be read
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+		this->m_notify    = 0;
+	}
+
+	if (this->m_process) {
+		// The exit callback would never run: close the handle while the loop is still there
+		uv_process_kill(this->m_process, SIGKILL);
+		uv_close(reinterpret_cast<uv_handle_t*>(this->m_process), close_process);
+		this->m_process = 0;
+		this->m_error   = UV_ECANCELED;
+	}
+
+	this->releaseAll();
+	this->m_pid    = 0;
+	this->m_exited = false;
+	this->m_buffers[0].setCache(0);
+	this->m_buffers[1].setCache(0);
+	this->m_disp = 0;
+}
+
+ProcessPipe* ProcessLibUvPrivate::createPipe(int channel)
+{
+	ProcessPipe* pipe = new ProcessPipe;
+	uv_pipe_init(this->m_disp->loop(), &pipe->handle, 0);
+	pipe->handle.data = pipe;
+	pipe->process     = this;
+	pipe->channel     = channel;
+	return pipe;
+}
+
+void ProcessLibUvPrivate::releasePipe(ProcessPipe*& pipe)
+{
+	if (pipe) {
+		// Writes still queued on the pipe complete with UV_ECANCELED and find no process
+		pipe->process = 0;
+		uv_close(reinterpret_cast<uv_handle_t*>(&pipe->handle), close_pipe);
+
+		if (pipe == this->m_stdin) {
+			this->m_to_write         = 0;
+			this->m_writes_in_flight = 0;
+			this->m_close_stdin      = false;
+		}
+
+		pipe = 0;
+	}
+}
+
+void ProcessLibUvPrivate::releaseAll(void)
+{
+	this->releasePipe(this->m_stdin);
+	this->releasePipe(this->m_output[ProcessLibUv::StandardOutput]);
+	this->releasePipe(this->m_output[ProcessLibUv::StandardError]);
+}
+
+bool ProcessLibUvPrivate::start(const QString& program, const QStringList& arguments)
+{
+	if (this->m_pid) {
+		qWarning("ProcessLibUv::start: the process is already running");
+		return false;
+	}
+
+	if (!this->m_disp) {
+		this->m_disp = EventDispatcherLibUvPrivate::current();
+		if (!this->m_disp) {
+			qWarning("ProcessLibUv: the thread does not run EventDispatcherLibUv");
+			this->m_error = UV_EINVAL;
+			return false;
+		}
+
+		this->m_disp->addClient(this);
+		this->m_buffers[0].setCache(&this->m_disp->streamBuffers());
+		this->m_buffers[1].setCache(&this->m_disp->streamBuffers());
+	}
+
+	this->m_error       = 0;
+	this->m_exit_code   = 0;
+	this->m_exit_signal = 0;
+	this->m_exited      = false;
+	this->clearReadBuffers();
+
+	// The byte arrays keep the strings alive for uv_spawn()
+	QByteArray file = QFile::encodeName(program);
+	QByteArray cwd  = QFile::encodeName(this->m_cwd);
+	QList<QByteArray> strings;
+	QVarLengthArray<char*, 16> args;
+	QVarLengthArray<char*, 64> env;
+
+	args.append(file.data());
+	for (int i=0; i<arguments.size(); ++i) {
+		strings.append(arguments.at(i).toLocal8Bit());
+		args.append(strings.last().data());
+	}
+
+	args.append(0);
+
+	for (int i=0; i<this->m_env.size(); ++i) {
+		strings.append(this->m_env.at(i).toLocal8Bit());
+		env.append(strings.last().data());
+	}
+
+	env.append(0);
+
+	this->m_stdin                                = this->createPipe(-1);
+	this->m_output[ProcessLibUv::StandardOutput] = this->createPipe(ProcessLibUv::StandardOutput);
+	this->m_output[ProcessLibUv::StandardError]  = this->createPipe(ProcessLibUv::StandardError);
+
+	uv_stdio_container_t stdio[3];
+	stdio[0].flags       = static_cast<uv_stdio_flags>(UV_CREATE_PIPE | UV_READABLE_PIPE);
+	stdio[0].data.stream = reinterpret_cast<uv_stream_t*>(&this->m_stdin->handle);
+	stdio[1].flags       = static_cast<uv_stdio_flags>(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+	stdio[1].data.stream = reinterpret_cast<uv_stream_t*>(&this->m_output[ProcessLibUv::StandardOutput]->handle);
+	stdio[2].flags       = static_cast<uv_stdio_flags>(UV_CREATE_PIPE | UV_WRITABLE_PIPE);
+	stdio[2].data.stream = reinterpret_cast<uv_stream_t*>(&this->m_output[ProcessLibUv::StandardError]->handle);
+
+	uv_process_options_t options;
+	memset(&options, 0, sizeof(options));
+	options.exit_cb     = &ProcessLibUvPrivate::exit_callback;
+	options.file        = file.constData();
+	options.args        = args.data();
+	options.env         = this->m_env.isEmpty() ? 0 : env.data();
+	options.cwd         = this->m_cwd.isEmpty() ? 0 : cwd.constData();
+	options.stdio_count = 3;
+	options.stdio       = stdio;
+
+	uv_process_t* process = new uv_process_t;
+	process->data         = this;
+
+	int rc = uv_spawn(this->m_disp->loop(), process, &options);
+	if (rc < 0) {
+		// The handle is initialized even if the process could not be spawned
+		uv_close(reinterpret_cast<uv_handle_t*>(process), close_process);
+		this->releaseAll();
+		this->fail(rc);
+		return false;
+	}
+
+	this->m_process = process;
+	this->m_pid     = process->pid;
+
+	for (int i=0; i<2; ++i) {
+		uv_stream_t* stream = reinterpret_cast<uv_stream_t*>(&this->m_output[i]->handle);
+		uv_read_start(stream, &ProcessLibUvPrivate::alloc_callback, &ProcessLibUvPrivate::read_callback);
+	}
+
+	this->schedule(StartedEvent);
+	return true;
+}
+
+bool ProcessLibUvPrivate::kill(int signum)
+{
+	if (!this->m_process) {
+		return false;
+	}
+
+	int rc = uv_process_kill(this->m_process, signum);
+	if (rc < 0) {
+		this->m_error = rc;
+		return false;
+	}
+
+	return true;
+}
+
+qint64 ProcessLibUvPrivate::write(const QByteArray& data)
+{
+	if (!this->m_stdin || this->m_close_stdin) {
+		qWarning("ProcessLibUv::write: the write channel is closed");
+		return -1;
+	}
+
+	if (data.isEmpty()) {
+		return 0;
+	}
+
+	// libuv writes to the pipe right away if nothing is queued; the request only keeps the data for the rest
+	WriteRequest* w = new WriteRequest;
+	w->req.data     = w;
+	w->size         = data.size();
+	w->data.append(data);
+
+	uv_buf_t buf = uv_buf_init(const_cast<char*>(data.constData()), static_cast<unsigned int>(data.size()));
+	int rc       = uv_write(&w->req, reinterpret_cast<uv_stream_t*>(&this->m_stdin->handle), &buf, 1, &ProcessLibUvPrivate::write_callback);
+	if (rc < 0) {
+		delete w;
+		this->fail(rc);
+		return -1;
+	}
+
+	++this->m_writes_in_flight;
+	this->m_to_write += w->size;
+	return w->size;
+}
+
+void ProcessLibUvPrivate::closeWriteChannel(void)
+{
+	if (this->m_writes_in_flight) {
+		this->m_close_stdin = true;
+	}
+	else {
+		this->releasePipe(this->m_stdin);
+	}
+}
+
+QByteArray ProcessLibUvPrivate::readAll(int channel)
+{
+	return this->m_buffers[channel].readAll();
+}
+
+void ProcessLibUvPrivate::clearReadBuffers(void)
+{
+	this->m_buffers[0].clear();
+	this->m_buffers[1].clear();
+}
+
+void ProcessLibUvPrivate::fail(int error)
+{
+	this->m_error = error;
+	this->schedule(ErrorEvent);
+}
+
+void ProcessLibUvPrivate::checkFinished(void)
+{
+	// Output written just before the exit may still be in the pipes when the exit callback runs
+	if (this->m_exited && !this->m_output[ProcessLibUv::StandardOutput] && !this->m_output[ProcessLibUv::StandardError]) {
+		this->releasePipe(this->m_stdin);
+		this->m_exited = false;
+		this->m_pid    = 0;
+		this->schedule(FinishedEvent);
+	}
+}
+
+void ProcessLibUvPrivate::schedule(int events)
+{
+	this->m_events |= events;
+	if (!this->m_notify && this->m_disp) {
+		this->m_notify = new ProcessNotifyTask(this);
+		this->m_disp->deferTask(this->m_notify);
+	}
+}
+
+void ProcessLibUvPrivate::notify(void)
+{
+	Q_Q(ProcessLibUv);
+
+	int events       = this->m_events;
+	qint64 written   = this->m_written;
+	this->m_events   = 0;
+	this->m_written  = 0;
+
+	// Any slot may destroy the object
+	QPointer<ProcessLibUv> guard(q);
+
+	if (events & StartedEvent) {
+		Q_EMIT q->started();
+		if (!guard) {
+			return;
+		}
+	}
+
+	if ((events & ReadyReadOutput) && this->m_buffers[ProcessLibUv::StandardOutput].size()) {
+		Q_EMIT q->readyReadStandardOutput();
+		if (!guard) {
+			return;
+		}
+	}
+
+	if ((events & ReadyReadError) && this->m_buffers[ProcessLibUv::StandardError].size()) {
+		Q_EMIT q->readyReadStandardError();
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (written) {
+		Q_EMIT q->bytesWritten(written);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (events & ErrorEvent) {
+		Q_EMIT q->errorOccurred(this->m_error);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (events & FinishedEvent) {
+		Q_EMIT q->finished(this->m_exit_code, this->m_exit_signal);
+	}
+}
+
+void ProcessLibUvPrivate::exit_callback(uv_process_t* process, int64_t exit_status, int term_signal)
+{
+	ProcessLibUvPrivate* d = static_cast<ProcessLibUvPrivate*>(process->data);
+	uv_close(reinterpret_cast<uv_handle_t*>(process), close_process);
+
+	if (d) {
+		d->m_process     = 0;
+		d->m_exited      = true;
+		d->m_exit_code   = exit_status;
+		d->m_exit_signal = term_signal;
+		d->checkFinished();
+	}
+}
+
+void ProcessLibUvPrivate::alloc_callback(uv_handle_t* handle, size_t suggested, uv_buf_t* buf)
+{
+	Q_UNUSED(suggested)
+
+	ProcessPipe* pipe = static_cast<ProcessPipe*>(handle->data);
+	pipe->process->m_buffers[pipe->channel].reserve(buf);
+}
+
+void ProcessLibUvPrivate::read_callback(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf)
+{
+	Q_UNUSED(buf)
+
+	ProcessPipe* pipe      = static_cast<ProcessPipe*>(stream->data);
+	ProcessLibUvPrivate* d = pipe->process;
+	d->m_buffers[pipe->channel].commit(nread);
+
+	if (nread > 0) {
+		d->schedule(ProcessLibUv::StandardOutput == pipe->channel ? ReadyReadOutput : ReadyReadError);
+		return;
+	}
+
+	if (nread < 0) {
+		// End of file, or the pipe broke: either way the channel is done
+		d->releasePipe(d->m_output[pipe->channel]);
+		d->checkFinished();
+	}
+}
+
+void ProcessLibUvPrivate::write_callback(uv_write_t* req, int status)
+{
+	WriteRequest* w        = static_cast<WriteRequest*>(req->data);
+	ProcessPipe* pipe      = static_cast<ProcessPipe*>(req->handle->data);
+	ProcessLibUvPrivate* d = pipe->process;
+
+	if (d) {
+		--d->m_writes_in_flight;
+		d->m_to_write -= w->size;
+		if (status < 0) {
+			// Typically UV_EPIPE: the child closed its standard input
+			d->releasePipe(d->m_stdin);
+			d->fail(status);
+		}
+		else {
+			d->m_written += w->size;
+			d->schedule(0);
+			if (!d->m_writes_in_flight && d->m_close_stdin) {
+				d->releasePipe(d->m_stdin);
+			}
+		}
+	}
+
+	delete w;
+}
+
+#endif // UV_VERSION_MAJOR >= 1
@@ -0,0 +1,93 @@
+#ifndef PROCESS_LIBUV_P_H
+#define PROCESS_LIBUV_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <uv.h>
+#include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+#include "eventdispatcher_libuv_p.h"
+
+class ProcessLibUv;
+class ProcessLibUvPrivate;
+
+// Standard stream of the child; process is 0 once the object is gone, the pipe is then only waiting to be closed
+struct Q_DECL_HIDDEN ProcessPipe {
+	uv_pipe_t handle;
+	ProcessLibUvPrivate* process;
+	int channel; // ProcessLibUv::ProcessChannel for the output pipes, -1 for standard input
+};
+
+class Q_DECL_HIDDEN ProcessNotifyTask : public EventDispatcherLibUv::Task {
+public:
+	explicit ProcessNotifyTask(ProcessLibUvPrivate* d) : EventDispatcherLibUv::Task(), d(d) {}
+	virtual void run(void);
+
+	ProcessLibUvPrivate* d;
+};
+
+class Q_DECL_HIDDEN ProcessLibUvPrivate : public LoopClient {
+public:
+	enum {
+		StartedEvent     = 0x01,
+		ReadyReadOutput  = 0x02,
+		ReadyReadError   = 0x04,
+		ErrorEvent       = 0x08,
+		FinishedEvent    = 0x10
+	};
+
+	ProcessLibUvPrivate(ProcessLibUv* const q);
+	virtual ~ProcessLibUvPrivate(void);
+
+	bool start(const QString& program, const QStringList& arguments);
+	bool kill(int signum);
+	qint64 write(const QByteArray& data);
+	void closeWriteChannel(void);
+	QByteArray readAll(int channel);
+	void notify(void);
+	virtual void detachFromLoop(void);
+
+private:
+	Q_DISABLE_COPY(ProcessLibUvPrivate)
+	Q_DECLARE_PUBLIC(ProcessLibUv)
+	ProcessLibUv* const q_ptr;
+
+	EventDispatcherLibUvPrivate* m_disp; // 0 once the dispatcher has gone away, see detachFromLoop()
+	uv_process_t* m_process;           // data points back to this object until the process exits
+	ProcessPipe* m_stdin;
+	ProcessPipe* m_output[2];          // indexed by ProcessLibUv::ProcessChannel
+	ProcessNotifyTask* m_notify;
+	QString m_cwd;
+	QStringList m_env;
+	qint64 m_pid;
+	int m_error;
+	int m_events;
+	qint64 m_exit_code;
+	int m_exit_signal;
+	bool m_exited;
+	bool m_close_stdin;                // closeWriteChannel() was called while writes were in flight
+	StreamReadBuffer m_buffers[2];     // indexed by ProcessLibUv::ProcessChannel
+	qint64 m_to_write;
+	qint64 m_written;                  // reported by the next bytesWritten()
+	int m_writes_in_flight;
+
+	ProcessPipe* createPipe(int channel);
+	void releasePipe(ProcessPipe*& pipe);
+	void releaseAll(void);
+	void clearReadBuffers(void);
+	void fail(int error);
+	void checkFinished(void);
+	void schedule(int events);
+
+	static void exit_callback(uv_process_t* process, int64_t exit_status, int term_signal);
+	static void alloc_callback(uv_handle_t* handle, size_t suggested, uv_buf_t* buf);
+	static void read_callback(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
+	static void write_callback(uv_write_t* req, int status);
+
+	friend class ProcessNotifyTask;
+	friend class ProcessLibUv;
+};
+
+#endif // PROCESS_LIBUV_P_H
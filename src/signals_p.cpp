@@ -0,0 +1,100 @@
+#include "eventdispatcher_libuv_p.h"
+
+bool EventDispatcherLibUvPrivate::watchSignal(int signum)
+{
+	if (this->m_signals.contains(signum)) {
+		return true;
+	}
+
+	SignalInfo* info = new SignalInfo;
+	info->disp       = this;
+	info->signum     = signum;
+	info->pending    = 0;
+	info->received   = 0;
+	info->emitted    = 0;
+
+	uv_signal_init(this->m_base, &info->ev);
+	info->ev.data = info;
+	if (uv_signal_start(&info->ev, &EventDispatcherLibUvPrivate::signal_callback, signum)) {
+		qWarning("%s: unable to watch signal %d", Q_FUNC_INFO, signum);
+		this->closeHandle(reinterpret_cast<uv_handle_t*>(&info->ev), &EventDispatcherLibUvPrivate::signal_close_callback);
+		return false;
+	}
+
+	// Like the wake up handle in host driven mode, a watched signal must not keep the loop alive
+	uv_unref(reinterpret_cast<uv_handle_t*>(&info->ev));
+	this->m_signals.insert(signum, info);
+	return true;
+}
+
+void EventDispatcherLibUvPrivate::unwatchSignal(int signum)
+{
+	SignalInfo* info = this->m_signals.take(signum);
+	if (info) {
+		int idx = this->m_signal_queue.indexOf(info);
+		if (idx != -1) {
+			this->m_signal_queue.remove(idx);
+		}
+
+		this->closeHandle(reinterpret_cast<uv_handle_t*>(&info->ev), &EventDispatcherLibUvPrivate::signal_close_callback);
+	}
+}
+
+void EventDispatcherLibUvPrivate::killSignals(void)
+{
+	SignalHash::ConstIterator it = this->m_signals.constBegin();
+	while (it != this->m_signals.constEnd()) {
+		this->closeHandle(reinterpret_cast<uv_handle_t*>(&it.value()->ev), &EventDispatcherLibUvPrivate::signal_close_callback);
+		++it;
+	}
+
+	this->m_signals.clear();
+	this->m_signal_queue.clear();
+}
+
+void EventDispatcherLibUvPrivate::signal_callback(uv_signal_t* w, int signum)
+{
+	Q_UNUSED(signum)
+
+	SignalInfo* info                  = static_cast<SignalInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+
+	++info->received;
+	if (!info->pending++) {
+		disp->m_signal_queue.append(info);
+		if (!disp->m_signal_task_queued) {
+			disp->m_signal_task_queued = true;
+			disp->deferTask(&disp->m_signal_task);
+		}
+	}
+}
+
+void EventDispatcherLibUvPrivate::signal_close_callback(uv_handle_t* w)
+{
+	SignalInfo* info                  = static_cast<SignalInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+	delete info;
+	disp->handleClosed();
+}
+
+void EventDispatcherLibUvPrivate::deliverSignals(void)
+{
+	Q_Q(EventDispatcherLibUv);
+
+	// A slot may reenter the event loop or unwatch signals, so each entry is taken off the queue before it is emitted
+	this->m_signal_task_queued = false;
+	while (!this->m_signal_queue.isEmpty()) {
+		SignalInfo* info = this->m_signal_queue.first();
+		this->m_signal_queue.remove(0);
+
+		int count     = info->pending;
+		info->pending = 0;
+		++info->emitted;
+		Q_EMIT q->unixSignal(info->signum, count);
+	}
+}
+
+void SignalTask::run(void)
+{
+	this->d->deliverSignals();
+}
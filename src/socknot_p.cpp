@@ -3,6 +3,13 @@
 #include <QtCore/QSocketNotifier>
 #include "eventdispatcher_libuv_p.h"
 
+namespace {
+
+	// A watcher without enabled notifiers is kept this long for the next registration of its descriptor
+	static const quint64 IDLE_NOTIFIER_LIFETIME = Q_UINT64_C(1000000000);
+
+}
+
 void EventDispatcherLibUvPrivate::registerSocketNotifier(QSocketNotifier* notifier)
 {
 	int sockfd = notifier->socket();
@@ -18,24 +25,131 @@ void EventDispatcherLibUvPrivate::registerSocketNotifier(QSocketNotifier* notifi
 			return;
 	}
 
-	uv_poll_t* data = new uv_poll_t;
-	uv_poll_init(this->m_base, data, sockfd);
-	data->data = notifier;
-	uv_poll_start(data, what, &EventDispatcherLibUvPrivate::socket_notifier_callback);
+	if (sockfd >= this->m_notifiers.size()) {
+		this->m_notifiers.resize(qMax(sockfd + 1, this->m_notifiers.size() * 2));
+	}
+
+	SocketNotifierInfo* info = this->m_notifiers.at(sockfd);
+	if (!info) {
+		info             = this->m_notifier_pool.allocate();
+		info->disp       = this;
+		info->read       = 0;
+		info->write      = 0;
+		info->idle_prev  = 0;
+		info->idle_next  = 0;
+		info->idle_since = 0;
+		info->events     = 0;
+		info->deferred   = 0;
+		info->carried    = 0;
+		info->serial     = this->nextSerial();
+		info->fd         = sockfd;
+		uv_poll_init(this->m_base, &info->ev, sockfd);
+		info->ev.data = info;
+		this->m_notifiers[sockfd] = info;
+	}
 
-	this->m_notifiers.insert(notifier, data);
+	QSocketNotifier*& slot = (UV_READABLE == what) ? info->read : info->write;
+	if (slot && slot != notifier) {
+		qWarning("%s: multiple socket notifiers for the same socket %d and type %s", Q_FUNC_INFO, sockfd, (UV_READABLE == what) ? "Read" : "Write");
+	}
+
+	if (info->idle_since) {
+		this->unlinkIdleNotifier(info);
+	}
+
+	slot = notifier;
+	if ((info->events & what) != what) {
+		info->events |= what;
+		uv_poll_start(&info->ev, info->events, &EventDispatcherLibUvPrivate::socket_notifier_callback);
+	}
 }
 
 void EventDispatcherLibUvPrivate::unregisterSocketNotifier(QSocketNotifier* notifier)
 {
-	SocketNotifierHash::Iterator it = this->m_notifiers.find(notifier);
-	if (it != this->m_notifiers.end()) {
-		uv_poll_t* data = it.value();
-		Q_ASSERT(data->data == notifier);
+	this->unregisterSocketNotifier(notifier->socket(), notifier);
+}
+
+void EventDispatcherLibUvPrivate::unregisterSocketNotifier(int sockfd, QSocketNotifier* notifier)
+{
+	if (sockfd >= this->m_notifiers.size()) {
+		return;
+	}
+
+	SocketNotifierInfo* info = this->m_notifiers.at(sockfd);
+	if (!info) {
+		return;
+	}
+
+	if (info->read == notifier) {
+		info->read    = 0;
+		info->events &= ~UV_READABLE;
+	}
+	else if (info->write == notifier) {
+		info->write   = 0;
+		info->events &= ~UV_WRITABLE;
+	}
+	else {
+		return;
+	}
+
+	if (info->events) {
+		// The other notifier for this descriptor is still there, just update the poll mask
+		uv_poll_start(&info->ev, info->events, &EventDispatcherLibUvPrivate::socket_notifier_callback);
+	}
+	else {
+		// QSocketNotifier::setEnabled() toggles are frequent: keep the handle for the next registration of the
+		// descriptor, whichever notifier makes it. The cache is keyed on the descriptor only, so a notifier that
+		// moves to another thread or is destroyed there leaves nothing behind that this thread has to clean up;
+		// processEvents() releases the handle once it has been idle for IDLE_NOTIFIER_LIFETIME.
+		// The new serial drops the activations still queued for the old registration
+		uv_poll_stop(&info->ev);
+		info->serial     = this->nextSerial();
+		info->deferred   = 0;
+		info->carried    = 0;
+		info->idle_since = qMax(this->m_loop_level ? this->m_now : uv_hrtime(), Q_UINT64_C(1));
+		info->idle_prev  = this->m_idle_tail;
+		info->idle_next  = 0;
+
+		if (this->m_idle_tail) {
+			this->m_idle_tail->idle_next = info;
+		}
+		else {
+			this->m_idle_head = info;
+		}
+
+		this->m_idle_tail = info;
+	}
+}
+
+void EventDispatcherLibUvPrivate::unlinkIdleNotifier(SocketNotifierInfo* info)
+{
+	if (info->idle_prev) {
+		info->idle_prev->idle_next = info->idle_next;
+	}
+	else {
+		this->m_idle_head = info->idle_next;
+	}
 
-		uv_poll_stop(data);
-		delete data;
-		it = this->m_notifiers.erase(it);
+	if (info->idle_next) {
+		info->idle_next->idle_prev = info->idle_prev;
+	}
+	else {
+		this->m_idle_tail = info->idle_prev;
+	}
+
+	info->idle_prev  = 0;
+	info->idle_next  = 0;
+	info->idle_since = 0;
+}
+
+void EventDispatcherLibUvPrivate::releaseIdleNotifiers(quint64 now)
+{
+	// The list is in the order the watchers went idle: only its head has to be looked at
+	while (this->m_idle_head && now >= this->m_idle_head->idle_since + IDLE_NOTIFIER_LIFETIME) {
+		SocketNotifierInfo* info = this->m_idle_head;
+		this->unlinkIdleNotifier(info);
+		this->m_notifiers[info->fd] = 0;
+		this->releaseSocketNotifier(info);
 	}
 }
 
@@ -43,58 +157,128 @@ void EventDispatcherLibUvPrivate::socket_notifier_callback(uv_poll_t* w, int sta
 {
 	Q_UNUSED(status)
 
-	EventDispatcherLibUvPrivate* disp = static_cast<EventDispatcherLibUvPrivate*>(w->loop->data);
-	QSocketNotifier* notifier         = static_cast<QSocketNotifier*>(w->data);
-	QSocketNotifier::Type type        = notifier->type();
+	SocketNotifierInfo* info          = static_cast<SocketNotifierInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+
+	if (disp->m_notifiers_masked) {
+		disp->deferSocketEvent(info, events);
+		return;
+	}
+
+	PendingEvent event;
+	event.timer  = 0;
+	event.socket = info;
+	event.serial = info->serial;
+
+	events &= ~info->carried;
+
+	if ((events & UV_READABLE) && info->read) {
+		event.events = UV_READABLE;
+		disp->m_event_list.append(event);
+	}
 
-	if ((QSocketNotifier::Read == type && (events & UV_READABLE)) || (QSocketNotifier::Write == type && (events & UV_WRITABLE))) {
-		PendingEvent event(notifier, new QEvent(QEvent::SockAct));
+	if ((events & UV_WRITABLE) && info->write) {
+		event.events = UV_WRITABLE;
 		disp->m_event_list.append(event);
 	}
 }
 
 bool EventDispatcherLibUvPrivate::disableSocketNotifiers(bool disable)
 {
-	SocketNotifierHash::Iterator it = this->m_notifiers.begin();
-	while (it != this->m_notifiers.end()) {
-		uv_poll_t* data = it.value();
-		if (disable) {
-			uv_poll_stop(data);
-		}
-		else {
-			QSocketNotifier* notifier = it.key();
-			int what;
-			switch (notifier->type()) {
-				case QSocketNotifier::Read:  what = UV_READABLE; break;
-				case QSocketNotifier::Write: what = UV_WRITABLE; break;
-				case QSocketNotifier::Exception: /// FIXME
-					continue;
-
-				default:
-					Q_ASSERT(false);
-					continue;
+	// Watchers stay registered with the OS; a watcher is stopped only when it fires while notifiers are masked
+	if (disable) {
+		++this->m_notifiers_masked;
+		return true;
+	}
+
+	Q_ASSERT(this->m_notifiers_masked > 0);
+	if (--this->m_notifiers_masked) {
+		return true;
+	}
+
+	EventList list;
+#if QT_VERSION >= 0x040800
+	list.swap(this->m_deferred_notifiers);
+#else
+	list = this->m_deferred_notifiers;
+	this->m_deferred_notifiers.clear();
+#endif
+
+	for (int i=0; i<list.size(); ++i) {
+		PendingEvent e           = list.at(i);
+		SocketNotifierInfo* info = e.socket;
+		if (info->serial == e.serial) {
+			int events     = info->deferred & info->events;
+			info->deferred = 0;
+			// The restarted watcher reports the descriptor again before the replayed activation is delivered
+			info->carried |= events;
+
+			if (info->events) {
+				uv_poll_start(&info->ev, info->events, &EventDispatcherLibUvPrivate::socket_notifier_callback);
 			}
 
-			uv_poll_start(data, what, &EventDispatcherLibUvPrivate::socket_notifier_callback);
-		}
+			if (events & UV_READABLE) {
+				e.events = UV_READABLE;
+				this->m_event_list.append(e);
+			}
 
-		++it;
+			if (events & UV_WRITABLE) {
+				e.events = UV_WRITABLE;
+				this->m_event_list.append(e);
+			}
+		}
 	}
 
+#if QT_VERSION >= 0x040800
+	list.erase(list.begin(), list.end());
+	this->m_deferred_notifiers.swap(list);
+#endif
+
 	return true;
 }
 
+void EventDispatcherLibUvPrivate::deferSocketEvent(SocketNotifierInfo* info, int events)
+{
+	// The watcher is level triggered: stop it, otherwise it would keep the loop spinning until the notifiers are unmasked
+	uv_poll_stop(&info->ev);
+
+	if (!info->deferred) {
+		PendingEvent e;
+		e.timer  = 0;
+		e.socket = info;
+		e.serial = info->serial;
+		e.events = 0;
+		this->m_deferred_notifiers.append(e);
+	}
+
+	info->deferred |= events;
+}
+
 void EventDispatcherLibUvPrivate::killSocketNotifiers(void)
 {
-	if (!this->m_notifiers.isEmpty()) {
-		SocketNotifierHash::Iterator it = this->m_notifiers.begin();
-		while (it != this->m_notifiers.end()) {
-			uv_poll_t* data = it.value();
-			uv_poll_stop(data);
-			delete data;
-			++it;
+	for (int i=0; i<this->m_notifiers.size(); ++i) {
+		SocketNotifierInfo* info = this->m_notifiers.at(i);
+		if (info) {
+			this->releaseSocketNotifier(info);
 		}
-
-		this->m_notifiers.clear();
 	}
+
+	this->m_notifiers.clear();
+	this->m_idle_head = 0;
+	this->m_idle_tail = 0;
+}
+
+void EventDispatcherLibUvPrivate::releaseSocketNotifier(SocketNotifierInfo* info)
+{
+	// uv_close() stops the watcher; the slot is recycled from the close callback
+	info->serial = 0;
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&info->ev), &EventDispatcherLibUvPrivate::socket_notifier_close_callback);
+}
+
+void EventDispatcherLibUvPrivate::socket_notifier_close_callback(uv_handle_t* w)
+{
+	SocketNotifierInfo* info          = static_cast<SocketNotifierInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+	disp->m_notifier_pool.release(info);
+	disp->handleClosed();
 }
@@ -0,0 +1,153 @@
+#ifndef STATISTICS_P_H
+#define STATISTICS_P_H
+
+#include <QtCore/QtGlobal>
+#if QT_VERSION >= 0x050300
+#	include <QtCore/QAtomicInteger>
+#else
+#	include <QtCore/QMutex>
+#endif
+#include "qt4compat.h"
+
+/*
+ * Counter written by the dispatcher's thread only and read from any thread. With a single writer an update is a
+ * relaxed load and store, not a read-modify-write: the dispatcher updates several counters per iteration.
+ * Qt versions without 64-bit atomics use a plain 64-bit value where loads and stores cannot tear, and a mutex
+ * elsewhere: the time counters are in nanoseconds and would wrap within seconds in 32 bits.
+ * A reset from another thread may be lost if it coincides with an update.
+ */
+class Q_DECL_HIDDEN StatCounter {
+public:
+#if QT_VERSION >= 0x050300
+	StatCounter(void) : m_value(0) {}
+
+	quint64 load(void) const { return this->m_value.load(); }
+	void add(quint64 v)      { this->m_value.store(this->m_value.load() + v); }
+	void store(quint64 v)    { this->m_value.store(v); }
+	void reset(void)         { this->m_value.store(0); }
+
+private:
+	QAtomicInteger<quint64> m_value;
+#elif QT_POINTER_SIZE == 8
+	StatCounter(void) : m_value(0) {}
+
+	quint64 load(void) const { return this->m_value; }
+	void add(quint64 v)      { this->m_value = this->m_value + v; }
+	void store(quint64 v)    { this->m_value = v; }
+	void reset(void)         { this->m_value = 0; }
+
+private:
+	volatile quint64 m_value;
+#else
+	StatCounter(void) : m_lock(), m_value(0) {}
+
+	quint64 load(void) const
+	{
+		QMutexLocker locker(&this->m_lock);
+		return this->m_value;
+	}
+
+	void add(quint64 v)
+	{
+		QMutexLocker locker(&this->m_lock);
+		this->m_value += v;
+	}
+
+	void store(quint64 v)
+	{
+		QMutexLocker locker(&this->m_lock);
+		this->m_value = v;
+	}
+
+	void reset(void) { this->store(0); }
+
+private:
+	mutable QMutex m_lock;
+	quint64 m_value;
+#endif
+
+	Q_DISABLE_COPY(StatCounter)
+};
+
+// Counter written by any thread
+class Q_DECL_HIDDEN SharedStatCounter {
+public:
+#if QT_VERSION >= 0x050300
+	SharedStatCounter(void) : m_value(0) {}
+
+	quint64 load(void) const { return this->m_value.load(); }
+	void add(quint64 v)      { this->m_value.fetchAndAddRelaxed(v); }
+	void reset(void)         { this->m_value.fetchAndStoreRelaxed(0); }
+
+private:
+	QAtomicInteger<quint64> m_value;
+#else
+	SharedStatCounter(void) : m_lock(), m_value(0) {}
+
+	quint64 load(void) const
+	{
+		QMutexLocker locker(&this->m_lock);
+		return this->m_value;
+	}
+
+	void add(quint64 v)
+	{
+		QMutexLocker locker(&this->m_lock);
+		this->m_value += v;
+	}
+
+	void reset(void)
+	{
+		QMutexLocker locker(&this->m_lock);
+		this->m_value = 0;
+	}
+
+private:
+	mutable QMutex m_lock;
+	quint64 m_value;
+#endif
+
+	Q_DISABLE_COPY(SharedStatCounter)
+};
+
+struct Q_DECL_HIDDEN LoopStatistics {
+	enum { LatenessBuckets = 16, CacheLine = 64 };
+
+	StatCounter iterations;
+	StatCounter blocked;    // ns
+	StatCounter dispatch;   // ns
+	StatCounter timers;
+	StatCounter sockets;
+	StatCounter zero_passes;
+	StatCounter spin_hits;  // busy polls that found an event
+	StatCounter blocks;     // uv_run(UV_RUN_ONCE) calls
+	StatCounter spinning;   // ns
+	StatCounter carried;    // activations left for the next iteration by a dispatch budget
+	StatCounter grid_saved; // coarse timer expirations on a shared grid point that had already been visited
+	StatCounter idle_base;  // libuv idle time at the last reset, ns
+	StatCounter lateness[LatenessBuckets];
+	quint64 accounted;      // time already attributed by nested processEvents() calls; dispatcher thread only
+
+	// Written by the threads calling wakeUp(): the padding keeps them off the cache lines the dispatcher writes
+	char pad_before[CacheLine];
+	SharedStatCounter wakeups;
+	SharedStatCounter coalesced;
+	char pad_after[CacheLine];
+
+	LoopStatistics(void) : accounted(0) {}
+
+	// Bucket 0 is for lateness under 1 us, bucket i for [2^(i-1), 2^i) us, the last one takes the rest
+	static int latenessBucket(quint64 ns)
+	{
+		quint64 us = ns / 1000;
+		int bucket = 0;
+		while (us && bucket < LatenessBuckets - 1) {
+			us >>= 1;
+			++bucket;
+		}
+
+		return bucket;
+	}
+};
+
+#endif // STATISTICS_P_H
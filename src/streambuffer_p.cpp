@@ -0,0 +1,103 @@
+#include <string.h>
+#include "eventdispatcher_libuv_p.h"
+
+void StreamReadBuffer::reserve(uv_buf_t* buf)
+{
+	if (!this->m_chunks.isEmpty()) {
+		ReadChunk& c = this->m_chunks.last();
+		if (StreamBuffer::Size - c.end >= MinReadSpace) {
+			*buf = uv_buf_init(c.buffer->data + c.end, StreamBuffer::Size - c.end);
+			return;
+		}
+	}
+
+	ReadChunk c;
+	c.buffer = this->m_cache ? this->m_cache->allocate() : new StreamBuffer;
+	c.begin  = 0;
+	c.end    = 0;
+	this->m_chunks.append(c);
+	*buf = uv_buf_init(c.buffer->data, StreamBuffer::Size);
+}
+
+void StreamReadBuffer::commit(ssize_t nread)
+{
+	if (nread > 0) {
+		// reserve() has handed out the free space at the end of the last chunk
+		this->m_chunks.last().end += static_cast<int>(nread);
+		this->m_size              += nread;
+	}
+	else if (!this->m_chunks.isEmpty() && this->m_chunks.last().begin == this->m_chunks.last().end) {
+		// Nothing was read: do not hold on to a buffer for an idle stream
+		this->release(this->m_chunks.last().buffer);
+		this->m_chunks.removeLast();
+	}
+}
+
+bool StreamReadBuffer::canReadLine(void) const
+{
+	for (int i=0; i<this->m_chunks.size(); ++i) {
+		const ReadChunk& c = this->m_chunks.at(i);
+		if (memchr(c.buffer->data + c.begin, '\n', c.end - c.begin)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+qint64 StreamReadBuffer::read(char* data, qint64 maxlen)
+{
+	qint64 copied = 0;
+	while (copied < maxlen && !this->m_chunks.isEmpty()) {
+		ReadChunk& c = this->m_chunks.first();
+		int n        = static_cast<int>(qMin(qint64(c.end - c.begin), maxlen - copied));
+		memcpy(data + copied, c.buffer->data + c.begin, n);
+		c.begin += n;
+		copied  += n;
+
+		// Drained buffers go back to the cache: idle streams hold no memory
+		if (c.begin == c.end) {
+			this->release(c.buffer);
+			this->m_chunks.removeFirst();
+		}
+	}
+
+	this->m_size -= copied;
+	return copied;
+}
+
+QByteArray StreamReadBuffer::readAll(void)
+{
+	QByteArray res;
+	res.reserve(static_cast<int>(this->m_size));
+
+	for (int i=0; i<this->m_chunks.size(); ++i) {
+		const ReadChunk& c = this->m_chunks.at(i);
+		res.append(c.buffer->data + c.begin, c.end - c.begin);
+		this->release(c.buffer);
+	}
+
+	this->m_chunks.clear();
+	this->m_size = 0;
+	return res;
+}
+
+void StreamReadBuffer::clear(void)
+{
+	for (int i=0; i<this->m_chunks.size(); ++i) {
+		this->release(this->m_chunks.at(i).buffer);
+	}
+
+	this->m_chunks.clear();
+	this->m_size = 0;
+}
+
+void StreamReadBuffer::release(StreamBuffer* buffer)
+{
+	if (this->m_cache) {
+		this->m_cache->release(buffer);
+	}
+	else {
+		delete buffer;
+	}
+}
@@ -0,0 +1,239 @@
+#include <QtCore/QPointer>
+#include <QtCore/QSocketNotifier>
+#include "eventdispatcher_libuv_p.h"
+
+#if QT_VERSION >= 0x040400
+
+namespace {
+
+	class RegisterSocketNotifierTask : public EventDispatcherLibUv::Task {
+	public:
+		RegisterSocketNotifierTask(EventDispatcherLibUvPrivate* d, QSocketNotifier* notifier)
+			: EventDispatcherLibUv::Task(), m_d(d), m_notifier(notifier)
+		{
+		}
+
+		virtual void run(void)
+		{
+			// The notifier may have been destroyed while the command was queued
+			if (this->m_notifier) {
+				this->m_d->registerSocketNotifier(this->m_notifier);
+			}
+		}
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		QPointer<QSocketNotifier> m_notifier;
+	};
+
+	class UnregisterSocketNotifierTask : public EventDispatcherLibUv::Task {
+	public:
+		UnregisterSocketNotifierTask(EventDispatcherLibUvPrivate* d, QSocketNotifier* notifier)
+			: EventDispatcherLibUv::Task(), m_d(d), m_notifier(notifier), m_sockfd(notifier->socket())
+		{
+		}
+
+		virtual void run(void)
+		{
+			// m_notifier is only compared, never dereferenced
+			this->m_d->unregisterSocketNotifier(this->m_sockfd, this->m_notifier);
+		}
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		QSocketNotifier* m_notifier;
+		int m_sockfd;
+	};
+
+	class RegisterTimerTask : public EventDispatcherLibUv::Task {
+	public:
+		RegisterTimerTask(EventDispatcherLibUvPrivate* d, int timerId, int interval, Qt::TimerType type, QObject* object, quint32 generation)
+			: EventDispatcherLibUv::Task(), m_d(d), m_object(object), m_timer_id(timerId), m_interval(interval), m_type(type), m_generation(generation)
+		{
+		}
+
+		virtual void run(void)
+		{
+			if (!this->m_object) {
+				return;
+			}
+
+			if (this->m_interval) {
+				this->m_d->registerTimer(this->m_timer_id, this->m_interval, this->m_type, this->m_object, this->m_generation);
+			}
+			else {
+				this->m_d->registerZeroTimer(this->m_timer_id, this->m_object, this->m_generation);
+			}
+		}
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		QPointer<QObject> m_object;
+		int m_timer_id;
+		int m_interval;
+		Qt::TimerType m_type;
+		quint32 m_generation;
+	};
+
+	class UnregisterTimerTask : public EventDispatcherLibUv::Task {
+	public:
+		UnregisterTimerTask(EventDispatcherLibUvPrivate* d, int timerId, quint32 generation)
+			: EventDispatcherLibUv::Task(), m_d(d), m_timer_id(timerId), m_generation(generation)
+		{
+		}
+
+		virtual void run(void) { this->m_d->unregisterTimer(this->m_timer_id, this->m_generation); }
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		int m_timer_id;
+		quint32 m_generation;
+	};
+
+	class UnregisterTimersTask : public EventDispatcherLibUv::Task {
+	public:
+		UnregisterTimersTask(EventDispatcherLibUvPrivate* d, QObject* object, quint32 generation)
+			: EventDispatcherLibUv::Task(), m_d(d), m_object(object), m_generation(generation)
+		{
+		}
+
+		virtual void run(void) { this->m_d->unregisterTimers(this->m_object, this->m_generation); }
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		QObject* m_object;
+		quint32 m_generation;
+	};
+
+}
+
+/*
+ * Producers push onto a lock-free LIFO stack; the dispatcher thread takes the whole stack at once
+ * in wake_up_handler() and appends it, reversed, to its private FIFO list. Only the first task pushed onto
+ * an empty stack needs to wake the loop up: until the stack is taken, the wake up is still pending.
+ */
+void EventDispatcherLibUvPrivate::postTask(EventDispatcherLibUv::Task* task)
+{
+	Q_Q(EventDispatcherLibUv);
+
+	EventDispatcherLibUv::Task* head;
+	do {
+#if QT_VERSION >= 0x050000
+		head = this->m_task_stack.load();
+#else
+		head = this->m_task_stack;
+#endif
+		task->m_next = head;
+	} while (!this->m_task_stack.testAndSetRelease(head, task));
+
+	if (!head) {
+		q->wakeUp();
+	}
+}
+
+void EventDispatcherLibUvPrivate::queueRegisterSocketNotifier(QSocketNotifier* notifier)
+{
+	this->postTask(new RegisterSocketNotifierTask(this, notifier));
+}
+
+void EventDispatcherLibUvPrivate::queueUnregisterSocketNotifier(QSocketNotifier* notifier)
+{
+	this->postTask(new UnregisterSocketNotifierTask(this, notifier));
+}
+
+void EventDispatcherLibUvPrivate::queueRegisterTimer(int timerId, int interval, Qt::TimerType type, QObject* object, quint32 generation)
+{
+	this->postTask(new RegisterTimerTask(this, timerId, interval, type, object, generation));
+}
+
+void EventDispatcherLibUvPrivate::queueUnregisterTimer(int timerId, quint32 generation)
+{
+	this->postTask(new UnregisterTimerTask(this, timerId, generation));
+}
+
+void EventDispatcherLibUvPrivate::queueUnregisterTimers(QObject* object, quint32 generation)
+{
+	this->postTask(new UnregisterTimersTask(this, object, generation));
+}
+
+#endif // QT_VERSION >= 0x040400
+
+void EventDispatcherLibUvPrivate::takeTasks(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv::Task* task = this->m_task_stack.fetchAndStoreAcquire(0);
+	if (!task) {
+		return;
+	}
+
+	EventDispatcherLibUv::Task* tail = task;
+	EventDispatcherLibUv::Task* head = 0;
+	while (task) {
+		EventDispatcherLibUv::Task* next = task->m_next;
+		task->m_next = head;
+		head         = task;
+		task         = next;
+	}
+
+	if (this->m_task_tail) {
+		this->m_task_tail->m_next = head;
+	}
+	else {
+		this->m_task_head = head;
+	}
+
+	this->m_task_tail = tail;
+#endif
+}
+
+void EventDispatcherLibUvPrivate::deferTask(EventDispatcherLibUv::Task* task)
+{
+	// Called from libuv callbacks: the task runs once uv_run() has returned
+	task->m_next = 0;
+	if (this->m_task_tail) {
+		this->m_task_tail->m_next = task;
+	}
+	else {
+		this->m_task_head = task;
+	}
+
+	this->m_task_tail = task;
+}
+
+bool EventDispatcherLibUvPrivate::runTasks(void)
+{
+	bool result = false;
+
+	// A task is unlinked before it runs: it may reenter the event loop, which continues with the next one
+	while (this->m_task_head) {
+		EventDispatcherLibUv::Task* task = this->m_task_head;
+		this->m_task_head = task->m_next;
+		if (!this->m_task_head) {
+			this->m_task_tail = 0;
+		}
+
+		task->run();
+		if (task->autoDelete()) {
+			delete task;
+		}
+
+		result = true;
+	}
+
+	return result;
+}
+
+void EventDispatcherLibUvPrivate::discardTasks(void)
+{
+	this->takeTasks();
+
+	while (this->m_task_head) {
+		EventDispatcherLibUv::Task* task = this->m_task_head;
+		this->m_task_head = task->m_next;
+		if (task->autoDelete()) {
+			delete task;
+		}
+	}
+
+	this->m_task_tail = 0;
+}
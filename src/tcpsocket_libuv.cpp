@@ -0,0 +1,206 @@
+#include "tcpsocket_libuv.h"
+#include "tcpsocket_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+TcpSocketLibUv::TcpSocketLibUv(QObject* parent)
+	: QIODevice(parent), d_ptr(new TcpSocketLibUvPrivate(this))
+{
+}
+
+TcpSocketLibUv::~TcpSocketLibUv(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+void TcpSocketLibUv::connectToHost(const QString& host, quint16 port)
+{
+	Q_D(TcpSocketLibUv);
+	d->connectToHost(host, port);
+}
+
+void TcpSocketLibUv::disconnectFromHost(void)
+{
+	Q_D(TcpSocketLibUv);
+	d->disconnectFromHost();
+}
+
+void TcpSocketLibUv::abort(void)
+{
+	Q_D(TcpSocketLibUv);
+	d->abort();
+}
+
+TcpSocketLibUv::SocketState TcpSocketLibUv::state(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->m_state;
+}
+
+int TcpSocketLibUv::error(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->m_error;
+}
+
+QString TcpSocketLibUv::localAddress(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->address(false);
+}
+
+quint16 TcpSocketLibUv::localPort(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->port(false);
+}
+
+QString TcpSocketLibUv::peerAddress(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->address(true);
+}
+
+quint16 TcpSocketLibUv::peerPort(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->port(true);
+}
+
+void TcpSocketLibUv::setNoDelay(bool enable)
+{
+	Q_D(TcpSocketLibUv);
+	d->setNoDelay(enable);
+}
+
+void TcpSocketLibUv::setKeepAlive(bool enable, unsigned int delay)
+{
+	Q_D(TcpSocketLibUv);
+	d->setKeepAlive(enable, delay);
+}
+
+void TcpSocketLibUv::setReadBufferSize(qint64 size)
+{
+	Q_D(TcpSocketLibUv);
+	d->setReadBufferSize(size);
+}
+
+qint64 TcpSocketLibUv::readBufferSize(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->m_read_limit;
+}
+
+qint64 TcpSocketLibUv::write(const QList<QByteArray>& buffers)
+{
+	if (!this->isWritable()) {
+		qWarning("TcpSocketLibUv::write: device not open for writing");
+		return -1;
+	}
+
+	Q_D(TcpSocketLibUv);
+	return d->send(buffers, false);
+}
+
+bool TcpSocketLibUv::isSequential(void) const
+{
+	return true;
+}
+
+qint64 TcpSocketLibUv::bytesAvailable(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->m_input.size() + QIODevice::bytesAvailable();
+}
+
+qint64 TcpSocketLibUv::bytesToWrite(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->m_to_write;
+}
+
+bool TcpSocketLibUv::canReadLine(void) const
+{
+	Q_D(const TcpSocketLibUv);
+	return d->canReadLine() || QIODevice::canReadLine();
+}
+
+void TcpSocketLibUv::close(void)
+{
+	Q_D(TcpSocketLibUv);
+	QIODevice::close();
+	d->abort();
+	d->clearReadBuffer();
+}
+
+qint64 TcpSocketLibUv::readData(char* data, qint64 maxlen)
+{
+	Q_D(TcpSocketLibUv);
+	return d->read(data, maxlen);
+}
+
+qint64 TcpSocketLibUv::writeData(const char* data, qint64 len)
+{
+	Q_D(TcpSocketLibUv);
+	return d->send(QList<QByteArray>() << QByteArray::fromRawData(data, static_cast<int>(len)), true);
+}
+
+TcpServerLibUv::TcpServerLibUv(QObject* parent)
+	: QObject(parent), d_ptr(new TcpServerLibUvPrivate(this))
+{
+}
+
+TcpServerLibUv::~TcpServerLibUv(void)
+{
+#if QT_VERSION < 0x040600
+	delete this->d_ptr;
+	this->d_ptr = 0;
+#endif
+}
+
+bool TcpServerLibUv::listen(const QString& address, quint16 port, int backlog)
+{
+	Q_D(TcpServerLibUv);
+	return d->listen(address, port, backlog);
+}
+
+void TcpServerLibUv::close(void)
+{
+	Q_D(TcpServerLibUv);
+	d->close();
+}
+
+bool TcpServerLibUv::isListening(void) const
+{
+	Q_D(const TcpServerLibUv);
+	return d->m_handle != 0;
+}
+
+quint16 TcpServerLibUv::serverPort(void) const
+{
+	Q_D(const TcpServerLibUv);
+	return d->serverPort();
+}
+
+int TcpServerLibUv::error(void) const
+{
+	Q_D(const TcpServerLibUv);
+	return d->m_error;
+}
+
+bool TcpServerLibUv::hasPendingConnections(void) const
+{
+	Q_D(const TcpServerLibUv);
+	return !d->m_pending.isEmpty();
+}
+
+TcpSocketLibUv* TcpServerLibUv::nextPendingConnection(void)
+{
+	Q_D(TcpServerLibUv);
+	return d->nextPendingConnection();
+}
+
+#endif // UV_VERSION_MAJOR >= 1
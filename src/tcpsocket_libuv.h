@@ -0,0 +1,118 @@
+#ifndef TCPSOCKET_LIBUV_H
+#define TCPSOCKET_LIBUV_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class TcpSocketLibUvPrivate;
+class TcpServerLibUvPrivate;
+class ThreadGroupLibUvPrivate;
+
+/*
+ * TCP connection driven directly by a uv_tcp_t on the loop of the thread's EventDispatcherLibUv, without socket notifiers:
+ * libuv reads into pooled buffers which read() copies from, writes go to the socket immediately if the kernel accepts them
+ * and are queued with uv_write() otherwise. Signals are emitted from the event loop, never from within read() or write().
+ * Error codes are negative libuv error codes. Requires libuv 1.0+.
+ */
+class TcpSocketLibUv : public QIODevice {
+	Q_OBJECT
+public:
+	enum SocketState {
+		UnconnectedState,
+		HostLookupState,
+		ConnectingState,
+		ConnectedState,
+		ClosingState
+	};
+
+	explicit TcpSocketLibUv(QObject* parent = 0);
+	virtual ~TcpSocketLibUv(void);
+
+	// host is a numeric IPv4/IPv6 address or a name resolved with uv_getaddrinfo()
+	void connectToHost(const QString& host, quint16 port);
+	// Closes the connection once the queued data has been written
+	void disconnectFromHost(void);
+	void abort(void);
+
+	SocketState state(void) const;
+	int error(void) const;
+
+	QString localAddress(void) const;
+	quint16 localPort(void) const;
+	QString peerAddress(void) const;
+	quint16 peerPort(void) const;
+
+	void setNoDelay(bool enable);
+	void setKeepAlive(bool enable, unsigned int delay = 60);
+	// Reading from the socket pauses while this many bytes are buffered; 0 means no limit
+	void setReadBufferSize(qint64 size);
+	qint64 readBufferSize(void) const;
+
+	using QIODevice::write;
+	// Writes the buffers with a single gathering call; the data is not copied
+	qint64 write(const QList<QByteArray>& buffers);
+
+	virtual bool isSequential(void) const;
+	virtual qint64 bytesAvailable(void) const;
+	virtual qint64 bytesToWrite(void) const;
+	virtual bool canReadLine(void) const;
+	virtual void close(void);
+
+Q_SIGNALS:
+	void connected(void);
+	void disconnected(void);
+	void errorOccurred(int error);
+
+protected:
+	virtual qint64 readData(char* data, qint64 maxlen);
+	virtual qint64 writeData(const char* data, qint64 len);
+
+private:
+	Q_DISABLE_COPY(TcpSocketLibUv)
+	Q_DECLARE_PRIVATE(TcpSocketLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<TcpSocketLibUvPrivate> d_ptr;
+#else
+	TcpSocketLibUvPrivate* d_ptr;
+#endif
+
+	friend class TcpServerLibUvPrivate;
+};
+
+class TcpServerLibUv : public QObject {
+	Q_OBJECT
+public:
+	explicit TcpServerLibUv(QObject* parent = 0);
+	virtual ~TcpServerLibUv(void);
+
+	// address must be a numeric IPv4 or IPv6 address
+	bool listen(const QString& address, quint16 port = 0, int backlog = 511);
+	void close(void);
+	bool isListening(void) const;
+	quint16 serverPort(void) const;
+	int error(void) const;
+
+	bool hasPendingConnections(void) const;
+	// The socket is a child of the server
+	TcpSocketLibUv* nextPendingConnection(void);
+
+Q_SIGNALS:
+	void newConnection(void);
+	void acceptError(int error);
+
+private:
+	Q_DISABLE_COPY(TcpServerLibUv)
+	Q_DECLARE_PRIVATE(TcpServerLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<TcpServerLibUvPrivate> d_ptr;
+#else
+	TcpServerLibUvPrivate* d_ptr;
+#endif
+
+	friend class ThreadGroupLibUvPrivate;
+};
+
+#endif // TCPSOCKET_LIBUV_H
@@ -0,0 +1,910 @@
+#include <QtCore/QPointer>
+#include <QtCore/QVarLengthArray>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#	include <errno.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+#include "tcpsocket_libuv.h"
+#include "tcpsocket_libuv_p.h"
+
+#if UV_VERSION_MAJOR >= 1
+
+namespace {
+
+	void close_handle(uv_handle_t* handle)
+	{
+		delete reinterpret_cast<uv_tcp_t*>(handle);
+	}
+
+	bool parseAddress(const QString& host, quint16 port, struct sockaddr_storage* addr)
+	{
+		QByteArray h = host.toUtf8();
+		return
+			   0 == uv_ip4_addr(h.constData(), port, reinterpret_cast<struct sockaddr_in*>(addr))
+			|| 0 == uv_ip6_addr(h.constData(), port, reinterpret_cast<struct sockaddr_in6*>(addr))
+		;
+	}
+
+	bool socketName(const uv_tcp_t* handle, bool peer, struct sockaddr_storage* addr)
+	{
+		int len = sizeof(struct sockaddr_storage);
+		int rc  = peer
+			? uv_tcp_getpeername(handle, reinterpret_cast<struct sockaddr*>(addr), &len)
+			: uv_tcp_getsockname(handle, reinterpret_cast<struct sockaddr*>(addr), &len)
+		;
+
+		return 0 == rc;
+	}
+
+	// libuv binds with SO_REUSEADDR only: the socket is created here to set SO_REUSEPORT before uv_tcp_bind()
+	int openReusePort(uv_tcp_t* handle, int family)
+	{
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+		int fd = ::socket(family, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -errno;
+		}
+
+		int on = 1;
+		if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+			int rc = -errno;
+			::close(fd);
+			return rc;
+		}
+
+		int rc = uv_tcp_open(handle, fd);
+		if (rc < 0) {
+			::close(fd);
+		}
+
+		return rc;
+#else
+		Q_UNUSED(handle)
+		Q_UNUSED(family)
+		return UV_ENOTSUP;
+#endif
+	}
+
+	quint16 socketPort(const struct sockaddr_storage& addr)
+	{
+		switch (addr.ss_family) {
+			case AF_INET:  return ntohs(reinterpret_cast<const struct sockaddr_in*>(&addr)->sin_port);
+			case AF_INET6: return ntohs(reinterpret_cast<const struct sockaddr_in6*>(&addr)->sin6_port);
+			default:       return 0;
+		}
+	}
+
+}
+
+void TcpSocketNotifyTask::run(void)
+{
+	if (this->d) {
+		this->d->m_notify = 0;
+		this->d->notify();
+	}
+}
+
+void TcpServerNotifyTask::run(void)
+{
+	if (this->d) {
+		this->d->m_notify = 0;
+		this->d->notify();
+	}
+}
+
+TcpSocketLibUvPrivate::TcpSocketLibUvPrivate(TcpSocketLibUv* const q)
+	: q_ptr(q), m_disp(0), m_handle(0), m_lookup(0), m_notify(0), m_state(TcpSocketLibUv::UnconnectedState),
+	  m_error(0), m_events(0), m_nodelay(false), m_keepalive(false), m_keepalive_delay(0), m_reading(false),
+	  m_input(), m_read_limit(0), m_pending(), m_to_write(0), m_written(0), m_writes_in_flight(0)
+{
+}
+
+TcpSocketLibUvPrivate::~TcpSocketLibUvPrivate(void)
+{
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+	}
+
+	if (this->m_lookup) {
+		this->m_lookup->socket = 0;
+	}
+
+	this->releaseHandle();
+	this->m_input.clear();
+
+	if (this->m_disp) {
+		this->m_disp->removeClient(this);
+	}
+}
+
+void TcpSocketLibUvPrivate::detachFromLoop(void)
+{
+	// The dispatcher is being destroyed: what is left in the read buffer can still be read
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+		this->m_notify    = 0;
+	}
+
+	if (this->m_lookup) {
+		this->m_lookup->socket = 0;
+		this->m_lookup         = 0;
+	}
+
+	if (TcpSocketLibUv::UnconnectedState != this->m_state) {
+		this->m_state = TcpSocketLibUv::UnconnectedState;
+		this->m_error = UV_ECANCELED;
+	}
+
+	this->releaseHandle();
+	this->m_input.setCache(0);
+	this->m_disp = 0;
+}
+
+bool TcpSocketLibUvPrivate::createHandle(void)
+{
+	if (!this->m_disp) {
+		this->m_disp = EventDispatcherLibUvPrivate::current();
+		if (!this->m_disp) {
+			qWarning("TcpSocketLibUv: the thread does not run EventDispatcherLibUv");
+			return false;
+		}
+
+		this->m_disp->addClient(this);
+		this->m_input.setCache(&this->m_disp->streamBuffers());
+	}
+
+	uv_tcp_t* handle = new uv_tcp_t;
+	int rc           = uv_tcp_init(this->m_disp->loop(), handle);
+	if (rc < 0) {
+		delete handle;
+		this->fail(rc);
+		return false;
+	}
+
+	handle->data   = this;
+	this->m_handle = handle;
+	uv_tcp_nodelay(handle, this->m_nodelay);
+	uv_tcp_keepalive(handle, this->m_keepalive, this->m_keepalive_delay);
+	return true;
+}
+
+void TcpSocketLibUvPrivate::releaseHandle(void)
+{
+	if (this->m_handle) {
+		// Requests still queued on the handle complete with UV_ECANCELED and find no socket
+		this->m_handle->data = 0;
+		uv_close(reinterpret_cast<uv_handle_t*>(this->m_handle), close_handle);
+		this->m_handle = 0;
+	}
+
+	this->m_reading          = false;
+	this->m_to_write         = 0;
+	this->m_writes_in_flight = 0;
+	this->m_pending.clear();
+}
+
+void TcpSocketLibUvPrivate::connectToHost(const QString& host, quint16 port)
+{
+	Q_Q(TcpSocketLibUv);
+
+	if (TcpSocketLibUv::UnconnectedState != this->m_state) {
+		qWarning("TcpSocketLibUv::connectToHost: the socket is already connected or connecting");
+		return;
+	}
+
+	this->m_error = 0;
+	this->clearReadBuffer();
+
+	// Without a handle the socket stays closed
+	if (!this->createHandle()) {
+		return;
+	}
+
+	q->open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+	struct sockaddr_storage addr;
+	if (parseAddress(host, port, &addr)) {
+		this->connectTo(reinterpret_cast<struct sockaddr*>(&addr));
+		return;
+	}
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	LookupRequest* req = new LookupRequest;
+	req->req.data      = req;
+	req->disp          = this->m_disp;
+	req->socket        = this;
+
+	EventDispatcherLibUvPrivate::threadPoolUsed();
+	int rc = uv_getaddrinfo(this->m_disp->loop(), &req->req, &TcpSocketLibUvPrivate::lookup_callback, host.toUtf8().constData(), QByteArray::number(port).constData(), &hints);
+	if (rc < 0) {
+		delete req;
+		this->fail(rc);
+		return;
+	}
+
+	this->m_lookup = req;
+	this->m_state  = TcpSocketLibUv::HostLookupState;
+	this->m_disp->requestStarted();
+}
+
+void TcpSocketLibUvPrivate::connectTo(const struct sockaddr* addr)
+{
+	uv_connect_t* req = new uv_connect_t;
+	int rc            = uv_tcp_connect(req, this->m_handle, addr, &TcpSocketLibUvPrivate::connect_callback);
+	if (rc < 0) {
+		delete req;
+		this->fail(rc);
+		return;
+	}
+
+	this->m_state = TcpSocketLibUv::ConnectingState;
+}
+
+void TcpSocketLibUvPrivate::adopt(EventDispatcherLibUvPrivate* disp, uv_tcp_t* handle)
+{
+	Q_Q(TcpSocketLibUv);
+
+	Q_ASSERT(!this->m_disp);
+	this->m_disp   = disp;
+	this->m_handle = handle;
+	handle->data   = this;
+	disp->addClient(this);
+	this->m_input.setCache(&disp->streamBuffers());
+	uv_tcp_nodelay(handle, this->m_nodelay);
+	uv_tcp_keepalive(handle, this->m_keepalive, this->m_keepalive_delay);
+
+	q->open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+	this->m_state = TcpSocketLibUv::ConnectedState;
+	this->startReading();
+}
+
+void TcpSocketLibUvPrivate::connected(void)
+{
+	this->m_state = TcpSocketLibUv::ConnectedState;
+	this->schedule(ConnectedEvent);
+	this->startReading();
+
+	if (!this->m_pending.isEmpty() && TcpSocketLibUv::ConnectedState == this->m_state) {
+		QList<QByteArray> pending = this->m_pending;
+		this->m_pending.clear();
+		this->m_to_write = 0;
+		this->send(pending, false);
+	}
+}
+
+void TcpSocketLibUvPrivate::disconnectFromHost(void)
+{
+	switch (this->m_state) {
+		case TcpSocketLibUv::HostLookupState:
+		case TcpSocketLibUv::ConnectingState:
+			this->abort();
+			return;
+
+		case TcpSocketLibUv::ConnectedState:
+			break;
+
+		default:
+			return;
+	}
+
+	// uv_shutdown() completes after the queued writes
+	uv_shutdown_t* req = new uv_shutdown_t;
+	int rc             = uv_shutdown(req, reinterpret_cast<uv_stream_t*>(this->m_handle), &TcpSocketLibUvPrivate::shutdown_callback);
+	if (rc < 0) {
+		delete req;
+		this->releaseHandle();
+		this->m_state = TcpSocketLibUv::UnconnectedState;
+		this->schedule(DisconnectedEvent);
+		return;
+	}
+
+	this->m_state = TcpSocketLibUv::ClosingState;
+}
+
+void TcpSocketLibUvPrivate::abort(void)
+{
+	Q_Q(TcpSocketLibUv);
+
+	const bool was_connected = TcpSocketLibUv::ConnectedState == this->m_state || TcpSocketLibUv::ClosingState == this->m_state;
+
+	if (this->m_lookup) {
+		this->m_lookup->socket = 0;
+		this->m_lookup         = 0;
+	}
+
+	this->releaseHandle();
+	this->m_state   = TcpSocketLibUv::UnconnectedState;
+	this->m_events &= ~DisconnectedEvent;
+
+	if (was_connected) {
+		Q_EMIT q->disconnected();
+	}
+}
+
+void TcpSocketLibUvPrivate::fail(int error)
+{
+	Q_Q(TcpSocketLibUv);
+
+	const bool was_connected = TcpSocketLibUv::ConnectedState == this->m_state || TcpSocketLibUv::ClosingState == this->m_state;
+
+	if (this->m_lookup) {
+		this->m_lookup->socket = 0;
+		this->m_lookup         = 0;
+	}
+
+	this->m_error = error;
+	q->setErrorString(QString::fromLatin1(uv_strerror(error)));
+	this->releaseHandle();
+	this->m_state = TcpSocketLibUv::UnconnectedState;
+	this->schedule(ErrorEvent | (was_connected ? DisconnectedEvent : 0));
+}
+
+QString TcpSocketLibUvPrivate::address(bool peer) const
+{
+	struct sockaddr_storage addr;
+	if (!this->m_handle || !socketName(this->m_handle, peer, &addr)) {
+		return QString();
+	}
+
+	char buf[64];
+	switch (addr.ss_family) {
+		case AF_INET:  uv_ip4_name(reinterpret_cast<const struct sockaddr_in*>(&addr), buf, sizeof(buf)); break;
+		case AF_INET6: uv_ip6_name(reinterpret_cast<const struct sockaddr_in6*>(&addr), buf, sizeof(buf)); break;
+		default:       return QString();
+	}
+
+	return QString::fromLatin1(buf);
+}
+
+quint16 TcpSocketLibUvPrivate::port(bool peer) const
+{
+	struct sockaddr_storage addr;
+	if (!this->m_handle || !socketName(this->m_handle, peer, &addr)) {
+		return 0;
+	}
+
+	return socketPort(addr);
+}
+
+void TcpSocketLibUvPrivate::setNoDelay(bool enable)
+{
+	this->m_nodelay = enable;
+	if (this->m_handle) {
+		uv_tcp_nodelay(this->m_handle, enable);
+	}
+}
+
+void TcpSocketLibUvPrivate::setKeepAlive(bool enable, unsigned int delay)
+{
+	this->m_keepalive       = enable;
+	this->m_keepalive_delay = delay;
+	if (this->m_handle) {
+		uv_tcp_keepalive(this->m_handle, enable, delay);
+	}
+}
+
+void TcpSocketLibUvPrivate::setReadBufferSize(qint64 size)
+{
+	this->m_read_limit = size;
+	if (this->m_reading && size > 0 && this->m_input.size() >= size) {
+		uv_read_stop(reinterpret_cast<uv_stream_t*>(this->m_handle));
+		this->m_reading = false;
+	}
+	else {
+		this->startReading();
+	}
+}
+
+void TcpSocketLibUvPrivate::startReading(void)
+{
+	if (this->m_reading || !this->m_handle || (TcpSocketLibUv::ConnectedState != this->m_state && TcpSocketLibUv::ClosingState != this->m_state)) {
+		return;
+	}
+
+	if (this->m_read_limit > 0 && this->m_input.size() >= this->m_read_limit) {
+		return;
+	}
+
+	int rc = uv_read_start(reinterpret_cast<uv_stream_t*>(this->m_handle), &TcpSocketLibUvPrivate::alloc_callback, &TcpSocketLibUvPrivate::read_callback);
+	if (rc < 0) {
+		this->fail(rc);
+		return;
+	}
+
+	this->m_reading = true;
+}
+
+bool TcpSocketLibUvPrivate::canReadLine(void) const
+{
+	return this->m_input.canReadLine();
+}
+
+qint64 TcpSocketLibUvPrivate::read(char* data, qint64 maxlen)
+{
+	qint64 copied = this->m_input.read(data, maxlen);
+	this->startReading();
+
+	if (!copied && maxlen && TcpSocketLibUv::ConnectedState != this->m_state && TcpSocketLibUv::ClosingState != this->m_state) {
+		return -1;
+	}
+
+	return copied;
+}
+
+void TcpSocketLibUvPrivate::clearReadBuffer(void)
+{
+	this->m_input.clear();
+}
+
+qint64 TcpSocketLibUvPrivate::send(const QList<QByteArray>& buffers, bool copy)
+{
+	Q_Q(TcpSocketLibUv);
+
+	qint64 total = 0;
+	for (int i=0; i<buffers.size(); ++i) {
+		total += buffers.at(i).size();
+	}
+
+	if (TcpSocketLibUv::HostLookupState == this->m_state || TcpSocketLibUv::ConnectingState == this->m_state) {
+		for (int i=0; i<buffers.size(); ++i) {
+			const QByteArray& b = buffers.at(i);
+			this->m_pending.append(copy ? QByteArray(b.constData(), b.size()) : b);
+		}
+
+		this->m_to_write += total;
+		return total;
+	}
+
+	if (TcpSocketLibUv::ConnectedState != this->m_state) {
+		q->setErrorString(TcpSocketLibUv::tr("Socket is not connected"));
+		return -1;
+	}
+
+	if (!total) {
+		return 0;
+	}
+
+	QVarLengthArray<uv_buf_t, 16> bufs;
+	for (int i=0; i<buffers.size(); ++i) {
+		const QByteArray& b = buffers.at(i);
+		if (!b.isEmpty()) {
+			bufs.append(uv_buf_init(const_cast<char*>(b.constData()), static_cast<unsigned int>(b.size())));
+		}
+	}
+
+	uv_stream_t* stream = reinterpret_cast<uv_stream_t*>(this->m_handle);
+	qint64 written      = 0;
+
+	// Nothing queued, so the order of the data is preserved: usually the kernel takes it all and no request is needed
+	if (!this->m_writes_in_flight) {
+		int rc = uv_try_write(stream, bufs.constData(), bufs.size());
+		if (rc >= 0) {
+			written = rc;
+		}
+		else if (UV_EAGAIN != rc && UV_ENOSYS != rc) {
+			this->fail(rc);
+			return -1;
+		}
+
+		if (written) {
+			this->m_written += written;
+			this->schedule(0);
+		}
+
+		if (written == total) {
+			return total;
+		}
+	}
+
+	int first   = 0;
+	qint64 skip = written;
+	while (skip >= static_cast<qint64>(bufs[first].len)) {
+		skip -= bufs[first].len;
+		++first;
+	}
+
+	bufs[first].base += skip;
+	bufs[first].len  -= skip;
+
+	WriteRequest* w = new WriteRequest;
+	w->req.data     = w;
+	w->size         = total - written;
+
+	if (copy) {
+		// The caller's data is only valid during writeData()
+		for (int i=first; i<bufs.size(); ++i) {
+			w->data.append(QByteArray(bufs[i].base, static_cast<int>(bufs[i].len)));
+			bufs[i].base = w->data.last().data();
+		}
+	}
+	else {
+		w->data = buffers;
+	}
+
+	int rc = uv_write(&w->req, stream, bufs.constData() + first, bufs.size() - first, &TcpSocketLibUvPrivate::write_callback);
+	if (rc < 0) {
+		delete w;
+		this->fail(rc);
+		return -1;
+	}
+
+	++this->m_writes_in_flight;
+	this->m_to_write += w->size;
+	return total;
+}
+
+void TcpSocketLibUvPrivate::schedule(int events)
+{
+	this->m_events |= events;
+	if (!this->m_notify && this->m_disp) {
+		this->m_notify = new TcpSocketNotifyTask(this);
+		this->m_disp->deferTask(this->m_notify);
+	}
+}
+
+void TcpSocketLibUvPrivate::notify(void)
+{
+	Q_Q(TcpSocketLibUv);
+
+	int events       = this->m_events;
+	qint64 written   = this->m_written;
+	this->m_events   = 0;
+	this->m_written  = 0;
+
+	// Any slot may destroy the socket
+	QPointer<TcpSocketLibUv> guard(q);
+
+	if (events & ConnectedEvent) {
+		Q_EMIT q->connected();
+		if (!guard) {
+			return;
+		}
+	}
+
+	if ((events & ReadyReadEvent) && this->m_input.size()) {
+		Q_EMIT q->readyRead();
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (written) {
+		Q_EMIT q->bytesWritten(written);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (events & ErrorEvent) {
+		Q_EMIT q->errorOccurred(this->m_error);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (events & DisconnectedEvent) {
+		Q_EMIT q->readChannelFinished();
+		if (!guard) {
+			return;
+		}
+
+		Q_EMIT q->disconnected();
+	}
+}
+
+void TcpSocketLibUvPrivate::lookup_callback(uv_getaddrinfo_t* req, int status, struct addrinfo* res)
+{
+	LookupRequest* r         = static_cast<LookupRequest*>(req->data);
+	TcpSocketLibUvPrivate* d = r->socket;
+
+	r->disp->requestFinished();
+	delete r;
+
+	if (d) {
+		d->m_lookup = 0;
+		if (status < 0) {
+			d->fail(status);
+		}
+		else {
+			d->connectTo(res->ai_addr);
+		}
+	}
+
+	uv_freeaddrinfo(res);
+}
+
+void TcpSocketLibUvPrivate::connect_callback(uv_connect_t* req, int status)
+{
+	TcpSocketLibUvPrivate* d = static_cast<TcpSocketLibUvPrivate*>(req->handle->data);
+	delete req;
+
+	if (!d) {
+		return;
+	}
+
+	if (status < 0) {
+		d->fail(status);
+	}
+	else {
+		d->connected();
+	}
+}
+
+void TcpSocketLibUvPrivate::shutdown_callback(uv_shutdown_t* req, int status)
+{
+	Q_UNUSED(status)
+
+	TcpSocketLibUvPrivate* d = static_cast<TcpSocketLibUvPrivate*>(req->handle->data);
+	delete req;
+
+	if (d) {
+		d->releaseHandle();
+		d->m_state = TcpSocketLibUv::UnconnectedState;
+		d->schedule(DisconnectedEvent);
+	}
+}
+
+void TcpSocketLibUvPrivate::alloc_callback(uv_handle_t* handle, size_t suggested, uv_buf_t* buf)
+{
+	Q_UNUSED(suggested)
+
+	TcpSocketLibUvPrivate* d = static_cast<TcpSocketLibUvPrivate*>(handle->data);
+	d->m_input.reserve(buf);
+}
+
+void TcpSocketLibUvPrivate::read_callback(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf)
+{
+	Q_UNUSED(buf)
+
+	TcpSocketLibUvPrivate* d = static_cast<TcpSocketLibUvPrivate*>(stream->data);
+	d->m_input.commit(nread);
+
+	if (nread > 0) {
+		if (d->m_read_limit > 0 && d->m_input.size() >= d->m_read_limit) {
+			uv_read_stop(stream);
+			d->m_reading = false;
+		}
+
+		d->schedule(ReadyReadEvent);
+		return;
+	}
+
+	if (UV_EOF == nread) {
+		d->releaseHandle();
+		d->m_state = TcpSocketLibUv::UnconnectedState;
+		d->schedule(DisconnectedEvent);
+	}
+	else if (nread < 0) {
+		d->fail(static_cast<int>(nread));
+	}
+}
+
+void TcpSocketLibUvPrivate::write_callback(uv_write_t* req, int status)
+{
+	WriteRequest* w          = static_cast<WriteRequest*>(req->data);
+	TcpSocketLibUvPrivate* d = static_cast<TcpSocketLibUvPrivate*>(req->handle->data);
+
+	if (d) {
+		--d->m_writes_in_flight;
+		d->m_to_write -= w->size;
+		if (status < 0) {
+			d->fail(status);
+		}
+		else {
+			d->m_written += w->size;
+			d->schedule(0);
+		}
+	}
+
+	delete w;
+}
+
+TcpServerLibUvPrivate::TcpServerLibUvPrivate(TcpServerLibUv* const q)
+	: q_ptr(q), m_disp(0), m_handle(0), m_notify(0), m_pending(), m_error(0), m_accept_error(0), m_new_connections(false),
+	  m_accept_hook(0), m_accept_data(0)
+{
+}
+
+TcpServerLibUvPrivate::~TcpServerLibUvPrivate(void)
+{
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+	}
+
+	this->close();
+
+	if (this->m_disp) {
+		this->m_disp->removeClient(this);
+	}
+}
+
+void TcpServerLibUvPrivate::detachFromLoop(void)
+{
+	if (this->m_notify) {
+		this->m_notify->d = 0;
+		this->m_notify    = 0;
+	}
+
+	this->close();
+	this->m_disp = 0;
+}
+
+bool TcpServerLibUvPrivate::listen(const QString& address, quint16 port, int backlog, bool reuseport)
+{
+	if (this->m_handle) {
+		qWarning("TcpServerLibUv::listen: the server is already listening");
+		return false;
+	}
+
+	EventDispatcherLibUvPrivate* disp = EventDispatcherLibUvPrivate::current();
+	if (!disp) {
+		qWarning("TcpServerLibUv: the thread does not run EventDispatcherLibUv");
+		this->m_error = UV_EINVAL;
+		return false;
+	}
+
+	struct sockaddr_storage addr;
+	if (!parseAddress(address, port, &addr)) {
+		this->m_error = UV_EINVAL;
+		return false;
+	}
+
+	uv_tcp_t* handle = new uv_tcp_t;
+	int rc           = uv_tcp_init(disp->loop(), handle);
+	if (rc < 0) {
+		delete handle;
+		this->m_error = rc;
+		return false;
+	}
+
+	handle->data = this;
+	if (reuseport) {
+		rc = openReusePort(handle, addr.ss_family);
+	}
+
+	if (rc >= 0) {
+		rc = uv_tcp_bind(handle, reinterpret_cast<struct sockaddr*>(&addr), 0);
+	}
+
+	if (rc >= 0) {
+		rc = uv_listen(reinterpret_cast<uv_stream_t*>(handle), backlog, &TcpServerLibUvPrivate::connection_callback);
+	}
+
+	if (rc < 0) {
+		uv_close(reinterpret_cast<uv_handle_t*>(handle), close_handle);
+		this->m_error = rc;
+		return false;
+	}
+
+	if (this->m_disp != disp) {
+		if (this->m_disp) {
+			this->m_disp->removeClient(this);
+		}
+
+		this->m_disp = disp;
+		disp->addClient(this);
+	}
+
+	this->m_handle = handle;
+	this->m_error  = 0;
+	return true;
+}
+
+void TcpServerLibUvPrivate::close(void)
+{
+	if (this->m_handle) {
+		this->m_handle->data = 0;
+		uv_close(reinterpret_cast<uv_handle_t*>(this->m_handle), close_handle);
+		this->m_handle = 0;
+	}
+
+	for (int i=0; i<this->m_pending.size(); ++i) {
+		uv_close(reinterpret_cast<uv_handle_t*>(this->m_pending.at(i)), close_handle);
+	}
+
+	this->m_pending.clear();
+}
+
+quint16 TcpServerLibUvPrivate::serverPort(void) const
+{
+	struct sockaddr_storage addr;
+	if (!this->m_handle || !socketName(this->m_handle, false, &addr)) {
+		return 0;
+	}
+
+	return socketPort(addr);
+}
+
+TcpSocketLibUv* TcpServerLibUvPrivate::nextPendingConnection(void)
+{
+	Q_Q(TcpServerLibUv);
+
+	if (this->m_pending.isEmpty()) {
+		return 0;
+	}
+
+	return TcpServerLibUvPrivate::wrap(this->m_disp, this->m_pending.takeFirst(), q);
+}
+
+TcpSocketLibUv* TcpServerLibUvPrivate::wrap(EventDispatcherLibUvPrivate* disp, uv_tcp_t* handle, QObject* parent)
+{
+	TcpSocketLibUv* socket = new TcpSocketLibUv(parent);
+	socket->d_func()->adopt(disp, handle);
+	return socket;
+}
+
+void TcpServerLibUvPrivate::schedule(void)
+{
+	if (!this->m_notify) {
+		this->m_notify = new TcpServerNotifyTask(this);
+		this->m_disp->deferTask(this->m_notify);
+	}
+}
+
+void TcpServerLibUvPrivate::notify(void)
+{
+	Q_Q(TcpServerLibUv);
+
+	int error                = this->m_accept_error;
+	bool fresh               = this->m_new_connections;
+	this->m_accept_error     = 0;
+	this->m_new_connections  = false;
+
+	QPointer<TcpServerLibUv> guard(q);
+
+	if (error) {
+		Q_EMIT q->acceptError(error);
+		if (!guard) {
+			return;
+		}
+	}
+
+	if (this->m_accept_hook) {
+		while (!this->m_pending.isEmpty()) {
+			this->m_accept_hook(this->m_pending.takeFirst(), this->m_accept_data);
+		}
+
+		return;
+	}
+
+	if (fresh && !this->m_pending.isEmpty()) {
+		Q_EMIT q->newConnection();
+	}
+}
+
+void TcpServerLibUvPrivate::connection_callback(uv_stream_t* server, int status)
+{
+	TcpServerLibUvPrivate* d = static_cast<TcpServerLibUvPrivate*>(server->data);
+	if (!d) {
+		return;
+	}
+
+	if (status >= 0) {
+		uv_tcp_t* client = new uv_tcp_t;
+		uv_tcp_init(server->loop, client);
+		client->data = 0;
+
+		status = uv_accept(server, reinterpret_cast<uv_stream_t*>(client));
+		if (status >= 0) {
+			d->m_pending.append(client);
+			d->m_new_connections = true;
+		}
+		else {
+			uv_close(reinterpret_cast<uv_handle_t*>(client), close_handle);
+		}
+	}
+
+	if (status < 0) {
+		d->m_accept_error = status;
+	}
+
+	d->schedule();
+}
+
+#endif // UV_VERSION_MAJOR >= 1
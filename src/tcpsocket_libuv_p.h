@@ -0,0 +1,155 @@
+#ifndef TCPSOCKET_LIBUV_P_H
+#define TCPSOCKET_LIBUV_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <uv.h>
+#include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+#include "eventdispatcher_libuv_p.h"
+
+class TcpSocketLibUv;
+class TcpServerLibUv;
+class TcpSocketLibUvPrivate;
+class TcpServerLibUvPrivate;
+class ThreadGroupLibUvPrivate;
+
+// Takes a connection accepted by TcpServerLibUvPrivate instead of newConnection(); runs after uv_run() has returned
+typedef void (*AcceptHook)(uv_tcp_t* client, void* data);
+
+// Outlives the socket if it is destroyed while the name is being resolved
+struct Q_DECL_HIDDEN LookupRequest {
+	uv_getaddrinfo_t req;
+	EventDispatcherLibUvPrivate* disp;
+	TcpSocketLibUvPrivate* socket;
+};
+
+// Emits the signals collected by libuv callbacks once uv_run() has returned; orphaned if the object goes away first
+class Q_DECL_HIDDEN TcpSocketNotifyTask : public EventDispatcherLibUv::Task {
+public:
+	explicit TcpSocketNotifyTask(TcpSocketLibUvPrivate* d) : EventDispatcherLibUv::Task(), d(d) {}
+	virtual void run(void);
+
+	TcpSocketLibUvPrivate* d;
+};
+
+class Q_DECL_HIDDEN TcpServerNotifyTask : public EventDispatcherLibUv::Task {
+public:
+	explicit TcpServerNotifyTask(TcpServerLibUvPrivate* d) : EventDispatcherLibUv::Task(), d(d) {}
+	virtual void run(void);
+
+	TcpServerLibUvPrivate* d;
+};
+
+class Q_DECL_HIDDEN TcpSocketLibUvPrivate : public LoopClient {
+public:
+	enum {
+		ConnectedEvent    = 0x01,
+		ReadyReadEvent    = 0x02,
+		ErrorEvent        = 0x04,
+		DisconnectedEvent = 0x08
+	};
+
+	TcpSocketLibUvPrivate(TcpSocketLibUv* const q);
+	virtual ~TcpSocketLibUvPrivate(void);
+
+	void connectToHost(const QString& host, quint16 port);
+	void disconnectFromHost(void);
+	void abort(void);
+	void adopt(EventDispatcherLibUvPrivate* disp, uv_tcp_t* handle);
+	QString address(bool peer) const;
+	quint16 port(bool peer) const;
+	void setNoDelay(bool enable);
+	void setKeepAlive(bool enable, unsigned int delay);
+	void setReadBufferSize(qint64 size);
+	bool canReadLine(void) const;
+	qint64 read(char* data, qint64 maxlen);
+	qint64 send(const QList<QByteArray>& buffers, bool copy);
+	void clearReadBuffer(void);
+	void notify(void);
+	virtual void detachFromLoop(void);
+
+private:
+	Q_DISABLE_COPY(TcpSocketLibUvPrivate)
+	Q_DECLARE_PUBLIC(TcpSocketLibUv)
+	TcpSocketLibUv* const q_ptr;
+
+	EventDispatcherLibUvPrivate* m_disp; // 0 once the dispatcher has gone away, see detachFromLoop()
+	uv_tcp_t* m_handle;                 // data points back to this object until the handle is released
+	LookupRequest* m_lookup;
+	TcpSocketNotifyTask* m_notify;      // queued with the dispatcher, 0 if no signals are pending
+	TcpSocketLibUv::SocketState m_state;
+	int m_error;
+	int m_events;
+	bool m_nodelay;
+	bool m_keepalive;
+	unsigned int m_keepalive_delay;
+	bool m_reading;
+	StreamReadBuffer m_input;
+	qint64 m_read_limit;
+	QList<QByteArray> m_pending;        // written before the connection was established
+	qint64 m_to_write;
+	qint64 m_written;                   // reported by the next bytesWritten()
+	int m_writes_in_flight;
+
+	bool createHandle(void);
+	void releaseHandle(void);
+	void connectTo(const struct sockaddr* addr);
+	void connected(void);
+	void fail(int error);
+	void startReading(void);
+	void schedule(int events);
+
+	static void lookup_callback(uv_getaddrinfo_t* req, int status, struct addrinfo* res);
+	static void connect_callback(uv_connect_t* req, int status);
+	static void shutdown_callback(uv_shutdown_t* req, int status);
+	static void alloc_callback(uv_handle_t* handle, size_t suggested, uv_buf_t* buf);
+	static void read_callback(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
+	static void write_callback(uv_write_t* req, int status);
+
+	friend class TcpSocketNotifyTask;
+	friend class TcpServerLibUvPrivate;
+};
+
+class Q_DECL_HIDDEN TcpServerLibUvPrivate : public LoopClient {
+public:
+	TcpServerLibUvPrivate(TcpServerLibUv* const q);
+	virtual ~TcpServerLibUvPrivate(void);
+
+	// reuseport sets SO_REUSEPORT so that several servers can share the address (Unix only)
+	bool listen(const QString& address, quint16 port, int backlog, bool reuseport = false);
+	void close(void);
+	quint16 serverPort(void) const;
+	TcpSocketLibUv* nextPendingConnection(void);
+	void notify(void);
+	virtual void detachFromLoop(void);
+
+	// Wraps a connected handle of disp's loop into a socket
+	static TcpSocketLibUv* wrap(EventDispatcherLibUvPrivate* disp, uv_tcp_t* handle, QObject* parent);
+
+private:
+	Q_DISABLE_COPY(TcpServerLibUvPrivate)
+	Q_DECLARE_PUBLIC(TcpServerLibUv)
+	TcpServerLibUv* const q_ptr;
+
+	EventDispatcherLibUvPrivate* m_disp;
+	uv_tcp_t* m_handle;
+	TcpServerNotifyTask* m_notify;
+	QList<uv_tcp_t*> m_pending;         // accepted, not taken by nextPendingConnection() yet
+	int m_error;
+	int m_accept_error;
+	bool m_new_connections;
+	AcceptHook m_accept_hook;
+	void* m_accept_data;
+
+	void schedule(void);
+
+	static void connection_callback(uv_stream_t* server, int status);
+
+	friend class TcpServerNotifyTask;
+	friend class TcpServerLibUv;
+	friend class ThreadGroupLibUvPrivate;
+};
+
+#endif // TCPSOCKET_LIBUV_P_H
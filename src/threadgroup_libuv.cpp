@@ -0,0 +1,105 @@
+#include <QtCore/QThread>
+#include <string.h>
+#include "threadgroup_libuv.h"
+#include "threadgroup_libuv_p.h"
+
+#if QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1
+
+ThreadGroupLibUv::ThreadGroupLibUv(QObject* parent)
+	: QObject(parent), d_ptr(new ThreadGroupLibUvPrivate(this))
+{
+}
+
+ThreadGroupLibUv::~ThreadGroupLibUv(void)
+{
+}
+
+bool ThreadGroupLibUv::start(int threads, const QList<int>& cpus)
+{
+	Q_D(ThreadGroupLibUv);
+	return d->start(threads, cpus);
+}
+
+void ThreadGroupLibUv::stop(void)
+{
+	Q_D(ThreadGroupLibUv);
+	d->stop();
+}
+
+bool ThreadGroupLibUv::isRunning(void) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return !d->m_members.isEmpty();
+}
+
+int ThreadGroupLibUv::threadCount(void) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return d->m_members.size();
+}
+
+QThread* ThreadGroupLibUv::workerThread(int index) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return (index >= 0 && index < d->m_members.size()) ? d->m_members.at(index)->thread : 0;
+}
+
+EventDispatcherLibUv* ThreadGroupLibUv::dispatcher(int index) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return (index >= 0 && index < d->m_members.size()) ? d->m_members.at(index)->dispatcher : 0;
+}
+
+bool ThreadGroupLibUv::listen(const QString& address, quint16 port, ConnectionHandler handler, void* data, Distribution mode, int backlog)
+{
+	Q_D(ThreadGroupLibUv);
+	return d->listen(address, port, handler, data, mode, backlog);
+}
+
+void ThreadGroupLibUv::close(void)
+{
+	Q_D(ThreadGroupLibUv);
+	d->close();
+}
+
+bool ThreadGroupLibUv::isListening(void) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return d->m_listening;
+}
+
+quint16 ThreadGroupLibUv::serverPort(void) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return d->m_listening ? d->m_port : 0;
+}
+
+int ThreadGroupLibUv::error(void) const
+{
+	Q_D(const ThreadGroupLibUv);
+	return d->m_error;
+}
+
+ThreadGroupLibUv::ThreadLoad ThreadGroupLibUv::threadLoad(int index) const
+{
+	Q_D(const ThreadGroupLibUv);
+
+	ThreadLoad res;
+	memset(&res, 0, sizeof(res));
+	res.cpu = -1;
+
+	if (index >= 0 && index < d->m_members.size()) {
+		const GroupMember* member              = d->m_members.at(index);
+		EventDispatcherLibUv::Statistics stats = member->dispatcher->statistics();
+
+		res.connections  = member->connections.load();
+		res.iterations   = stats.iterations;
+		res.blockedTime  = stats.blockedTime;
+		res.dispatchTime = stats.dispatchTime;
+		res.cpu          = member->cpu;
+	}
+
+	return res;
+}
+
+#endif // QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1
@@ -0,0 +1,72 @@
+#ifndef THREADGROUP_LIBUV_H
+#define THREADGROUP_LIBUV_H
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class QThread;
+class EventDispatcherLibUv;
+class TcpSocketLibUv;
+class ThreadGroupLibUvPrivate;
+
+/*
+ * Runs a fixed number of threads with an EventDispatcherLibUv each and spreads the connections of one TCP port over
+ * them: either every thread listens on the port with SO_REUSEPORT and the kernel picks the thread, or the first thread
+ * accepts all connections and hands them out round-robin as descriptors, so the sockets are created on their thread.
+ * All functions must be called from the thread that owns the group. Error codes are negative libuv error codes.
+ * Requires Qt 5 (QThread::setEventDispatcher()), libuv 1.0+ and a Unix system.
+ */
+class ThreadGroupLibUv : public QObject {
+	Q_OBJECT
+public:
+	enum Distribution {
+		ReusePort,    // one listening socket per thread, balanced by the kernel
+		AcceptHandoff // one listening socket on the first thread, connections handed out round-robin
+	};
+
+	// Called on the thread the connection was assigned to; the socket has no parent and belongs to the handler
+	typedef void (*ConnectionHandler)(TcpSocketLibUv* socket, int thread, void* data);
+
+	// May be read at any time; times are in nanoseconds, see EventDispatcherLibUv::Statistics
+	struct ThreadLoad {
+		quint64 connections;  // connections given to the handler on this thread
+		quint64 iterations;
+		quint64 blockedTime;
+		quint64 dispatchTime;
+		int cpu;              // the thread is pinned to this CPU, -1 if it is not pinned
+	};
+
+	explicit ThreadGroupLibUv(QObject* parent = 0);
+	// Stops the group
+	virtual ~ThreadGroupLibUv(void);
+
+	// Thread i is pinned to cpus[i % cpus.size()] (Linux only); an empty list leaves the threads to the scheduler
+	bool start(int threads, const QList<int>& cpus = QList<int>());
+	// Closes the listener and waits for the threads to finish; sockets still owned by the handler must be gone by then
+	void stop(void);
+	bool isRunning(void) const;
+	int threadCount(void) const;
+	QThread* workerThread(int index) const;
+	EventDispatcherLibUv* dispatcher(int index) const;
+
+	// address must be a numeric IPv4 or IPv6 address; with port 0 all threads share the port picked for the first one
+	bool listen(const QString& address, quint16 port, ConnectionHandler handler, void* data = 0, Distribution mode = ReusePort, int backlog = 511);
+	void close(void);
+	bool isListening(void) const;
+	quint16 serverPort(void) const;
+	int error(void) const;
+
+	ThreadLoad threadLoad(int index) const;
+
+private:
+	Q_DISABLE_COPY(ThreadGroupLibUv)
+	Q_DECLARE_PRIVATE(ThreadGroupLibUv)
+#if QT_VERSION >= 0x040600
+	QScopedPointer<ThreadGroupLibUvPrivate> d_ptr;
+#else
+	ThreadGroupLibUvPrivate* d_ptr;
+#endif
+};
+
+#endif // THREADGROUP_LIBUV_H
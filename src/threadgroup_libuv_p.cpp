@@ -0,0 +1,280 @@
+#include <QtCore/QThread>
+#include "tcpsocket_libuv.h"
+#include "tcpsocket_libuv_p.h"
+#include "threadgroup_libuv.h"
+#include "threadgroup_libuv_p.h"
+#ifdef Q_OS_UNIX
+#	include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+#if QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1
+
+namespace {
+
+	void close_handle(uv_handle_t* handle)
+	{
+		delete reinterpret_cast<uv_tcp_t*>(handle);
+	}
+
+}
+
+void GroupCallTask::run(void)
+{
+	this->m_f(this->m_member);
+	this->m_done->release();
+}
+
+#ifdef Q_OS_UNIX
+HandoffTask::~HandoffTask(void)
+{
+	if (this->m_fd >= 0) {
+		::close(this->m_fd);
+	}
+}
+
+void HandoffTask::run(void)
+{
+	EventDispatcherLibUvPrivate* disp = EventDispatcherLibUvPrivate::current();
+	uv_tcp_t* client                  = new uv_tcp_t;
+	uv_tcp_init(disp->loop(), client);
+	client->data = 0;
+
+	if (uv_tcp_open(client, this->m_fd) < 0) {
+		uv_close(reinterpret_cast<uv_handle_t*>(client), close_handle);
+		return;
+	}
+
+	this->m_fd = -1;
+	this->m_member->group->deliver(this->m_member, client);
+}
+#endif
+
+ThreadGroupLibUvPrivate::ThreadGroupLibUvPrivate(ThreadGroupLibUv* const q)
+	: q_ptr(q), m_members(), m_handler(0), m_handler_data(0), m_mode(ThreadGroupLibUv::ReusePort), m_address(),
+	  m_port(0), m_backlog(0), m_next(0), m_listening(false), m_error(0)
+{
+}
+
+ThreadGroupLibUvPrivate::~ThreadGroupLibUvPrivate(void)
+{
+	this->stop();
+}
+
+bool ThreadGroupLibUvPrivate::start(int threads, const QList<int>& cpus)
+{
+	if (!this->m_members.isEmpty()) {
+		qWarning("ThreadGroupLibUv::start: the group is already running");
+		return false;
+	}
+
+	if (threads <= 0) {
+		return false;
+	}
+
+	this->m_members.reserve(threads);
+	for (int i=0; i<threads; ++i) {
+		GroupMember* member = new GroupMember;
+		member->group       = this;
+		member->index       = i;
+#ifdef Q_OS_LINUX
+		member->cpu         = cpus.isEmpty() ? -1 : cpus.at(i % cpus.size());
+#else
+		member->cpu         = -1;
+#endif
+		member->thread      = new QThread;
+		member->dispatcher  = new EventDispatcherLibUv;
+		member->server      = 0;
+		member->error       = 0;
+
+		// The thread takes the dispatcher over and deletes it when it finishes
+		member->thread->setEventDispatcher(member->dispatcher);
+		member->thread->start();
+		this->m_members.append(member);
+
+		if (member->cpu >= 0) {
+			this->call(member, &ThreadGroupLibUvPrivate::pin);
+		}
+	}
+
+#ifndef Q_OS_LINUX
+	if (!cpus.isEmpty()) {
+		qWarning("ThreadGroupLibUv::start: CPU pinning is not supported on this platform");
+	}
+#endif
+
+	return true;
+}
+
+void ThreadGroupLibUvPrivate::stop(void)
+{
+	this->close();
+
+	for (int i=0; i<this->m_members.size(); ++i) {
+		this->m_members.at(i)->thread->quit();
+	}
+
+	for (int i=0; i<this->m_members.size(); ++i) {
+		GroupMember* member = this->m_members.at(i);
+		member->thread->wait();
+		delete member->thread;
+		delete member;
+	}
+
+	this->m_members.clear();
+}
+
+bool ThreadGroupLibUvPrivate::listen(const QString& address, quint16 port, ThreadGroupLibUv::ConnectionHandler handler, void* data, ThreadGroupLibUv::Distribution mode, int backlog)
+{
+	if (this->m_members.isEmpty()) {
+		qWarning("ThreadGroupLibUv::listen: the group is not running");
+		this->m_error = UV_EINVAL;
+		return false;
+	}
+
+	if (this->m_listening) {
+		qWarning("ThreadGroupLibUv::listen: the group is already listening");
+		return false;
+	}
+
+	if (!handler) {
+		this->m_error = UV_EINVAL;
+		return false;
+	}
+
+	this->m_handler      = handler;
+	this->m_handler_data = data;
+	this->m_mode         = mode;
+	this->m_address      = address;
+	this->m_port         = port;
+	this->m_backlog      = backlog;
+	this->m_next         = 0;
+
+	// Handed off connections are accepted by the first thread only
+	int listeners = (ThreadGroupLibUv::AcceptHandoff == mode) ? 1 : this->m_members.size();
+	for (int i=0; i<listeners; ++i) {
+		GroupMember* member = this->m_members.at(i);
+		this->call(member, &ThreadGroupLibUvPrivate::startListening);
+		if (member->error < 0) {
+			this->m_error = member->error;
+			this->close();
+			return false;
+		}
+
+		if (!this->m_port) {
+			this->m_port = member->server->serverPort();
+		}
+	}
+
+	this->m_listening = true;
+	this->m_error     = 0;
+	return true;
+}
+
+void ThreadGroupLibUvPrivate::close(void)
+{
+	// Every thread is visited, the first one first: tasks run in order, so once the call returns on a thread,
+	// the connections handed off to it before the acceptor went away have been delivered
+	for (int i=0; i<this->m_members.size(); ++i) {
+		this->call(this->m_members.at(i), &ThreadGroupLibUvPrivate::stopListening);
+	}
+
+	this->m_listening = false;
+}
+
+void ThreadGroupLibUvPrivate::deliver(GroupMember* member, uv_tcp_t* client)
+{
+	TcpSocketLibUv* socket = TcpServerLibUvPrivate::wrap(EventDispatcherLibUvPrivate::current(), client, 0);
+	member->connections.add(1);
+	this->m_handler(socket, member->index, this->m_handler_data);
+}
+
+void ThreadGroupLibUvPrivate::call(GroupMember* member, void (*f)(GroupMember*))
+{
+	Q_ASSERT(QThread::currentThread() != member->thread);
+
+	QSemaphore done;
+	member->dispatcher->postTask(new GroupCallTask(f, member, &done));
+	done.acquire();
+}
+
+void ThreadGroupLibUvPrivate::pin(GroupMember* member)
+{
+#ifdef Q_OS_LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(member->cpu, &set);
+
+	int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (rc != 0) {
+		qWarning("ThreadGroupLibUv: failed to pin thread %d to CPU %d", member->index, member->cpu);
+		member->cpu   = -1;
+		member->error = -rc;
+		return;
+	}
+#endif
+
+	member->error = 0;
+}
+
+void ThreadGroupLibUvPrivate::startListening(GroupMember* member)
+{
+	ThreadGroupLibUvPrivate* g = member->group;
+	TcpServerLibUv* server     = new TcpServerLibUv;
+	TcpServerLibUvPrivate* sd  = server->d_func();
+	bool reuseport             = (ThreadGroupLibUv::ReusePort == g->m_mode);
+
+	if (!sd->listen(g->m_address, g->m_port, g->m_backlog, reuseport)) {
+		member->error = sd->m_error;
+		delete server;
+		return;
+	}
+
+	sd->m_accept_hook = reuseport ? &ThreadGroupLibUvPrivate::accept_hook : &ThreadGroupLibUvPrivate::handoff_hook;
+	sd->m_accept_data = member;
+	member->server    = server;
+	member->error     = 0;
+}
+
+void ThreadGroupLibUvPrivate::stopListening(GroupMember* member)
+{
+	delete member->server;
+	member->server = 0;
+}
+
+void ThreadGroupLibUvPrivate::accept_hook(uv_tcp_t* client, void* data)
+{
+	GroupMember* member = static_cast<GroupMember*>(data);
+	member->group->deliver(member, client);
+}
+
+void ThreadGroupLibUvPrivate::handoff_hook(uv_tcp_t* client, void* data)
+{
+	GroupMember* member        = static_cast<GroupMember*>(data);
+	ThreadGroupLibUvPrivate* g = member->group;
+	GroupMember* target        = g->m_members.at(g->m_next);
+	g->m_next                  = (g->m_next + 1) % g->m_members.size();
+
+	if (target == member) {
+		g->deliver(member, client);
+		return;
+	}
+
+#ifdef Q_OS_UNIX
+	// A handle cannot move to another loop: the descriptor is duplicated for the target's loop and the handle closed
+	uv_os_fd_t fd;
+	int copy = (uv_fileno(reinterpret_cast<uv_handle_t*>(client), &fd) < 0) ? -1 : ::dup(fd);
+	if (copy >= 0) {
+		uv_close(reinterpret_cast<uv_handle_t*>(client), close_handle);
+		target->dispatcher->postTask(new HandoffTask(target, copy));
+		return;
+	}
+#endif
+
+	g->deliver(member, client);
+}
+
+#endif // QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1
@@ -0,0 +1,97 @@
+#ifndef THREADGROUP_LIBUV_P_H
+#define THREADGROUP_LIBUV_P_H
+
+#include <QtCore/QSemaphore>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <uv.h>
+#include "qt4compat.h"
+#include "eventdispatcher_libuv.h"
+#include "eventdispatcher_libuv_p.h"
+#include "statistics_p.h"
+#include "threadgroup_libuv.h"
+
+class QThread;
+class TcpServerLibUv;
+class ThreadGroupLibUvPrivate;
+
+struct Q_DECL_HIDDEN GroupMember {
+	ThreadGroupLibUvPrivate* group;
+	int index;
+	int cpu;
+	QThread* thread;
+	EventDispatcherLibUv* dispatcher;
+	TcpServerLibUv* server;          // created, used and destroyed on the member's thread
+	StatCounter connections;
+	int error;                       // result of the last call run on the member's thread
+};
+
+// Runs a function on a member's thread; the owner of the group waits on done, the task itself is deleted by the dispatcher
+class Q_DECL_HIDDEN GroupCallTask : public EventDispatcherLibUv::Task {
+public:
+	GroupCallTask(void (*f)(GroupMember*), GroupMember* member, QSemaphore* done)
+		: EventDispatcherLibUv::Task(), m_f(f), m_member(member), m_done(done)
+	{
+	}
+
+	virtual void run(void);
+
+private:
+	void (*m_f)(GroupMember*);
+	GroupMember* m_member;
+	QSemaphore* m_done;
+};
+
+#ifdef Q_OS_UNIX
+// Carries an accepted descriptor to the member's thread; the descriptor is closed if the task never runs
+class Q_DECL_HIDDEN HandoffTask : public EventDispatcherLibUv::Task {
+public:
+	HandoffTask(GroupMember* member, int fd) : EventDispatcherLibUv::Task(), m_member(member), m_fd(fd) {}
+	virtual ~HandoffTask(void);
+	virtual void run(void);
+
+private:
+	GroupMember* m_member;
+	int m_fd;
+};
+#endif
+
+class Q_DECL_HIDDEN ThreadGroupLibUvPrivate {
+public:
+	ThreadGroupLibUvPrivate(ThreadGroupLibUv* const q);
+	~ThreadGroupLibUvPrivate(void);
+
+	bool start(int threads, const QList<int>& cpus);
+	void stop(void);
+	bool listen(const QString& address, quint16 port, ThreadGroupLibUv::ConnectionHandler handler, void* data, ThreadGroupLibUv::Distribution mode, int backlog);
+	void close(void);
+	void deliver(GroupMember* member, uv_tcp_t* client);
+
+private:
+	Q_DISABLE_COPY(ThreadGroupLibUvPrivate)
+	Q_DECLARE_PUBLIC(ThreadGroupLibUv)
+	ThreadGroupLibUv* const q_ptr;
+
+	QVector<GroupMember*> m_members;
+	ThreadGroupLibUv::ConnectionHandler m_handler;
+	void* m_handler_data;
+	ThreadGroupLibUv::Distribution m_mode;
+	QString m_address;
+	quint16 m_port;                  // the port every listener binds to; set by the first one if 0 was requested
+	int m_backlog;
+	int m_next;                      // next member for a handed off connection; first member's thread only
+	bool m_listening;
+	int m_error;
+
+	void call(GroupMember* member, void (*f)(GroupMember*));
+
+	static void pin(GroupMember* member);
+	static void startListening(GroupMember* member);
+	static void stopListening(GroupMember* member);
+	static void accept_hook(uv_tcp_t* client, void* data);
+	static void handoff_hook(uv_tcp_t* client, void* data);
+
+	friend class ThreadGroupLibUv;
+};
+
+#endif // THREADGROUP_LIBUV_P_H
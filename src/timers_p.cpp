@@ -3,13 +3,101 @@
 #include <QtCore/QPair>
 #include "eventdispatcher_libuv_p.h"
 
-#ifdef WIN32
-#	include "win32_utils.h"
+namespace {
+
+	static const quint64 NSEC_PER_MSEC = Q_UINT64_C(1000000);
+	static const quint64 NSEC_PER_SEC  = Q_UINT64_C(1000000000);
+
+	// Shared alignment grid: grid msec << 8 | slack percent, 0 if disabled. g_grid_last is the index of the grid point
+	// a coarse timer expired at most recently, in any thread
+#if QT_VERSION >= 0x040400
+	static QAtomicInt g_grid(0);
+	static QAtomicInt g_grid_last(0);
+
+	static int loadGrid(void)
+	{
+#	if QT_VERSION >= 0x050000
+		return g_grid.load();
+#	else
+		return g_grid;
+#	endif
+	}
+
+	static bool gridPointVisited(int point)
+	{
+		return g_grid_last.fetchAndStoreRelaxed(point) == point;
+	}
+#else
+	static volatile int g_grid      = 0;
+	static volatile int g_grid_last = 0;
+
+	static int loadGrid(void)
+	{
+		return g_grid;
+	}
+
+	static bool gridPointVisited(int point)
+	{
+		int last    = g_grid_last;
+		g_grid_last = point;
+		return last == point;
+	}
 #endif
 
-namespace {
+	// True if the registration is more recent than the generation a queued command was issued at; 0 is older than anything
+	static inline bool isNewer(quint32 registration, quint32 generation)
+	{
+		return generation && static_cast<qint32>(registration - generation) > 0;
+	}
 
-	static void calculateCoarseTimerTimeout(TimerInfo* info, const struct timeval& now, struct timeval& when)
+	// Per-object timer lists are linked through obj_prev and obj_next
+	template<typename T>
+	static void linkNode(T*& head, T* node)
+	{
+		node->obj_prev = 0;
+		node->obj_next = head;
+		if (head) {
+			head->obj_prev = node;
+		}
+
+		head = node;
+	}
+
+	template<typename T>
+	static void unlinkNode(T*& head, T* node)
+	{
+		if (node->obj_prev) {
+			node->obj_prev->obj_next = node->obj_next;
+		}
+		else {
+			head = node->obj_next;
+		}
+
+		if (node->obj_next) {
+			node->obj_next->obj_prev = node->obj_prev;
+		}
+	}
+
+	// Moves the deadline to the first grid point not before it, unless that takes more than the slack
+	static bool alignToGrid(quint64 ideal, quint64 interval, quint64& when)
+	{
+		const int packed = loadGrid();
+		if (!packed) {
+			return false;
+		}
+
+		const quint64 grid  = static_cast<quint64>(packed >> 8) * NSEC_PER_MSEC;
+		const quint64 slack = interval * static_cast<quint64>(packed & 0xFF) / 100;
+		const quint64 point = ((ideal + grid - 1) / grid) * grid;
+		if (point - ideal > slack) {
+			return false;
+		}
+
+		when = point;
+		return true;
+	}
+
+	static quint64 calculateCoarseTimerTimeout(TimerInfo* info, quint64 now)
 	{
 		Q_ASSERT(info->interval > 20);
 		// The coarse timer works like this:
@@ -29,9 +117,9 @@ namespace {
 		// The objective is to make most timers wake up at the same time, thereby reducing CPU wakeups.
 
 		int interval     = info->interval;
-		int msec         = static_cast<int>(info->when.tv_usec / 1000);
+		int msec         = static_cast<int>((info->when % NSEC_PER_SEC) / NSEC_PER_MSEC);
 		int max_rounding = interval / 20; // 5%
-		when             = info->when;
+		quint64 second   = info->when - info->when % NSEC_PER_SEC;
 
 		if (interval < 100 && (interval % 25) != 0) {
 			if (interval < 50) {
@@ -101,61 +189,44 @@ namespace {
 			}
 		}
 
-		if (msec == 1000) {
-			++when.tv_sec;
-			when.tv_usec = 0;
-		}
-		else {
-			when.tv_usec = msec * 1000;
-		}
-
-		if (timercmp(&when, &now, <)) {
-			when.tv_sec  += interval / 1000;
-			when.tv_usec += (interval % 1000) * 1000;
-			if (when.tv_usec > 999999) {
-				++when.tv_sec;
-				when.tv_usec -= 1000000;
-			}
+		quint64 when = second + static_cast<quint64>(msec) * NSEC_PER_MSEC;
+		if (when < now) {
+			when += static_cast<quint64>(interval) * NSEC_PER_MSEC;
 		}
 
-		Q_ASSERT(timercmp(&now, &when, <=));
+		Q_ASSERT(now <= when);
+		return when;
 	}
 }
 
-uint64_t calculateNextTimeout(TimerInfo* info, const struct timeval& now)
+uint64_t calculateNextTimeout(TimerInfo* info, quint64 now)
 {
-	struct timeval tv_interval;
-	struct timeval when;
-	tv_interval.tv_sec  = info->interval / 1000;
-	tv_interval.tv_usec = (info->interval % 1000) * 1000;
+	const quint64 interval = info->ns_interval ? info->ns_interval : static_cast<quint64>(info->interval) * NSEC_PER_MSEC;
+	quint64 when;
 
 	if (info->interval) {
-		qlonglong tnow  = (qlonglong(now.tv_sec)        * 1000) + (now.tv_usec        / 1000);
-		qlonglong twhen = (qlonglong(info->when.tv_sec) * 1000) + (info->when.tv_usec / 1000);
-
-		if ((info->interval < 1000 && twhen - tnow > 1500) || (info->interval >= 1000 && twhen - tnow > 1.2*info->interval)) {
+		if ((info->interval < 1000 && info->when > now + 1500 * NSEC_PER_MSEC) || (info->interval >= 1000 && info->when > now + interval + interval / 5)) {
 			info->when = now;
 		}
 	}
 
 	if (Qt::VeryCoarseTimer == info->type) {
-		if (info->when.tv_usec >= 500000) {
-			++info->when.tv_sec;
+		// Round to the nearest second
+		info->when  = ((info->when + NSEC_PER_SEC / 2) / NSEC_PER_SEC) * NSEC_PER_SEC;
+		info->when += static_cast<quint64>(info->interval / 1000) * NSEC_PER_SEC;
+		if (info->when <= now - now % NSEC_PER_SEC) {
+			info->when = now - now % NSEC_PER_SEC + static_cast<quint64>(info->interval / 1000) * NSEC_PER_SEC;
 		}
 
-		info->when.tv_usec = 0;
-		info->when.tv_sec += info->interval / 1000;
-		if (info->when.tv_sec <= now.tv_sec) {
-			info->when.tv_sec = now.tv_sec + info->interval / 1000;
+		if (!alignToGrid(info->when, interval, when)) {
+			when = info->when;
 		}
-
-		when = info->when;
 	}
 	else if (Qt::PreciseTimer == info->type) {
 		if (info->interval) {
-			timeradd(&info->when, &tv_interval, &info->when);
-			if (timercmp(&info->when, &now, <)) {
-				timeradd(&now, &tv_interval, &info->when);
+			info->when += interval;
+			if (info->when < now) {
+				info->when = now + interval;
 			}
 
 			when = info->when;
@@ -165,31 +236,63 @@ uint64_t calculateNextTimeout(TimerInfo* info, const struct timeval& now)
 		}
 	}
 	else {
-		timeradd(&info->when, &tv_interval, &info->when);
-		if (timercmp(&info->when, &now, <)) {
-			timeradd(&now, &tv_interval, &info->when);
+		info->when += interval;
+		if (info->when < now) {
+			info->when = now + interval;
 		}
 
-		calculateCoarseTimerTimeout(info, now, when);
+		// The shared grid is coarser than the per-dispatcher rounding, which is used if the slack does not reach a grid point
+		if (!alignToGrid(info->when, interval, when)) {
+			when = calculateCoarseTimerTimeout(info, now);
+		}
 	}
 
-	return static_cast<uint64_t>(when.tv_sec - now.tv_sec)*1000 + static_cast<uint64_t>(when.tv_usec - now.tv_usec)/1000;
+	info->due = when;
+
+	// libuv timers have millisecond resolution; round up so that the timer never fires early
+	return (when > now) ? (when - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC : 0;
 }
 
+void setSharedTimerGrid(int msec, int slack)
+{
+	const int packed = (msec > 0) ? (qMin(msec, 0x7FFFFF) << 8) | qBound(0, slack, 100) : 0;
+#if QT_VERSION >= 0x040400
+	g_grid.fetchAndStoreRelaxed(packed);
+#else
+	g_grid = packed;
+#endif
+}
 
-void EventDispatcherLibUvPrivate::registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object)
+int sharedTimerGrid(int* slack)
+{
+	const int packed = loadGrid();
+	if (slack) {
+		*slack = packed & 0xFF;
+	}
+
+	return packed >> 8;
+}
+
+void EventDispatcherLibUvPrivate::registerTimer(int timerId, int interval, Qt::TimerType type, QObject* object, quint32 generation)
 {
 	Q_ASSERT(interval > 0);
 
-	struct timeval now;
-	gettimeofday(&now, 0);
+	// Outside of processEvents() the cached time may be arbitrarily old
+	if (!this->m_loop_level) {
+		this->updateTime(true);
+	}
+
+	const quint64 now = this->m_now;
 
-	TimerInfo* info = new TimerInfo;
+	TimerInfo* info = this->m_timer_pool.allocate();
+	info->disp      = this;
 	info->timerId   = timerId;
 	info->interval  = interval;
 	info->type      = type;
 	info->object    = object;
-	info->when      = now; // calculateNextTimeout() will take care of info->when
+	info->serial     = this->nextSerial();
+	info->generation = generation;
+	info->when       = now; // calculateNextTimeout() will take care of info->when
 
 	if (Qt::CoarseTimer == type) {
 		if (interval >= 20000) {
@@ -200,102 +303,241 @@ void EventDispatcherLibUvPrivate::registerTimer(int timerId, int interval, Qt::T
 		}
 	}
 
+	info->ns_interval = 0;
+	info->hires_index = -1;
+	info->hires       = false;
+
 	uint64_t delta = calculateNextTimeout(info, now);
 
-	uv_timer_t* tmp = &info->ev;
-	uv_timer_init(this->m_base, tmp);
-	info->ev.data = info;
-	uv_timer_start(tmp, EventDispatcherLibUvPrivate::timer_callback, delta, 0);
+	info->wheel = this->m_wheel_enabled && Qt::PreciseTimer != info->type;
+	if (info->wheel) {
+		if (!this->m_wheel) {
+			this->m_wheel = new TimerWheel(uv_now(this->m_base));
+		}
+
+		info->node.level = -1;
+		info->node.data  = info;
+	}
+	else {
+		uv_timer_t* tmp = &info->ev;
+		uv_timer_init(this->m_base, tmp);
+		info->ev.data = info;
+	}
+
+	this->armTimer(info, delta);
 	this->m_timers.insert(timerId, info);
+	this->linkTimer(info);
+}
+
+void EventDispatcherLibUvPrivate::armTimer(TimerInfo* info, uint64_t delta)
+{
+#ifdef Q_OS_LINUX
+	if (info->hires) {
+		// The deadline is info->when, delta is rounded to milliseconds
+		this->armHiResTimer(info);
+		return;
+	}
+#endif
+
+	if (info->wheel) {
+		quint64 due = uv_now(this->m_base) + delta;
+		this->m_wheel->insert(&info->node, due);
+
+		if (due < this->m_wheel_due || !uv_is_active(reinterpret_cast<uv_handle_t*>(&this->m_wheel_timer))) {
+			this->scheduleWheel();
+		}
+	}
+	else {
+		uv_timer_start(&info->ev, &EventDispatcherLibUvPrivate::timer_callback, delta, 0);
+	}
 }
 
-void EventDispatcherLibUvPrivate::registerZeroTimer(int timerId, QObject* object)
+bool EventDispatcherLibUvPrivate::isTimerArmed(const TimerInfo* info) const
 {
-	ZeroTimer data;
-	data.object = object;
-	data.active = true;
-	this->m_zero_timers.insert(timerId, data);
+	if (info->hires) {
+		return info->hires_index >= 0;
+	}
+
+	if (info->wheel) {
+		return TimerWheel::isActive(&info->node);
+	}
+
+	return uv_is_active(reinterpret_cast<const uv_handle_t*>(&info->ev));
+}
+
+void EventDispatcherLibUvPrivate::scheduleWheel(void)
+{
+	quint64 due;
+	if (this->m_wheel->nextExpiry(due)) {
+		quint64 now       = uv_now(this->m_base);
+		this->m_wheel_due = due;
+		uv_timer_start(&this->m_wheel_timer, &EventDispatcherLibUvPrivate::wheel_callback, (due > now) ? due - now : 0, 0);
+	}
+	else {
+		uv_timer_stop(&this->m_wheel_timer);
+	}
 }
 
-bool EventDispatcherLibUvPrivate::unregisterTimer(int timerId)
+void EventDispatcherLibUvPrivate::registerZeroTimer(int timerId, QObject* object, quint32 generation)
+{
+	ZeroTimer* timer  = this->m_zero_pool.allocate();
+	timer->object     = object;
+	timer->timerId    = timerId;
+	timer->serial     = this->m_zero_serial++;
+	timer->generation = generation;
+	timer->active     = true;
+	timer->next       = 0;
+	timer->prev       = this->m_zero_tail;
+
+	if (this->m_zero_tail) {
+		this->m_zero_tail->next = timer;
+	}
+	else {
+		this->m_zero_head = timer;
+		if (!this->m_timers_masked) {
+			uv_idle_start(&this->m_zero_idle, &EventDispatcherLibUvPrivate::zero_timer_callback);
+		}
+	}
+
+	this->m_zero_tail = timer;
+	this->m_zero_timers.insert(timerId, timer);
+	this->linkZeroTimer(timer);
+}
+
+void EventDispatcherLibUvPrivate::linkTimer(TimerInfo* info)
+{
+	linkNode(this->m_object_timers[info->object].timers, info);
+}
+
+void EventDispatcherLibUvPrivate::unlinkTimer(TimerInfo* info)
+{
+	ObjectTimerHash::Iterator it = this->m_object_timers.find(info->object);
+	Q_ASSERT(it != this->m_object_timers.end());
+	unlinkNode(it.value().timers, info);
+	if (!it.value().timers && !it.value().zero) {
+		this->m_object_timers.erase(it);
+	}
+}
+
+void EventDispatcherLibUvPrivate::linkZeroTimer(ZeroTimer* timer)
+{
+	linkNode(this->m_object_timers[timer->object].zero, timer);
+}
+
+void EventDispatcherLibUvPrivate::unlinkZeroTimer(ZeroTimer* timer)
+{
+	ObjectTimerHash::Iterator it = this->m_object_timers.find(timer->object);
+	Q_ASSERT(it != this->m_object_timers.end());
+	unlinkNode(it.value().zero, timer);
+	if (!it.value().timers && !it.value().zero) {
+		this->m_object_timers.erase(it);
+	}
+}
+
+bool EventDispatcherLibUvPrivate::unregisterTimer(int timerId, quint32 generation)
 {
 	TimerHash::Iterator it = this->m_timers.find(timerId);
 	if (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-		uv_timer_stop(&info->ev);
-		delete info;
+		if (isNewer(it.value()->generation, generation)) {
+			return false;
+		}
+
+		this->unlinkTimer(it.value());
+		this->releaseTimer(it.value());
 		this->m_timers.erase(it);
 		return true;
 	}
 
-	return this->m_zero_timers.remove(timerId) > 0;
+	ZeroTimerHash::Iterator zit = this->m_zero_timers.find(timerId);
+	if (zit != this->m_zero_timers.end()) {
+		if (isNewer(zit.value()->generation, generation)) {
+			return false;
+		}
+
+		this->unlinkZeroTimer(zit.value());
+		this->releaseZeroTimer(zit.value());
+		this->m_zero_timers.erase(zit);
+		return true;
+	}
+
+	return false;
 }
 
-bool EventDispatcherLibUvPrivate::unregisterTimers(QObject* object)
+bool EventDispatcherLibUvPrivate::unregisterTimers(QObject* object, quint32 generation)
 {
-	bool result = false;
-	TimerHash::Iterator it = this->m_timers.begin();
-	while (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-
-		if (object == info->object) {
-			result = true;
-			uv_timer_stop(&info->ev);
-			delete info;
-			it = this->m_timers.erase(it);
-		}
-		else {
-			++it;
-		}
+	ObjectTimerHash::Iterator it = this->m_object_timers.find(object);
+	if (it == this->m_object_timers.end()) {
+		return false;
 	}
 
-	ZeroTimerHash::Iterator zit = this->m_zero_timers.begin();
-	while (zit != this->m_zero_timers.end()) {
-		ZeroTimer& data = zit.value();
-		if (object == data.object) {
-			result = true;
-			zit    = this->m_zero_timers.erase(zit);
+	if (generation) {
+		// Queued from another thread: the object may have started new timers since, these stay
+		ObjectTimers list = it.value();
+		bool result       = false;
+
+		for (TimerInfo* info = list.timers; info; ) {
+			TimerInfo* next = info->obj_next;
+			result         |= this->unregisterTimer(info->timerId, generation);
+			info            = next;
 		}
-		else {
-			++zit;
+
+		for (ZeroTimer* timer = list.zero; timer; ) {
+			ZeroTimer* next = timer->obj_next;
+			result         |= this->unregisterTimer(timer->timerId, generation);
+			timer           = next;
 		}
+
+		return result;
 	}
 
-	return result;
+	ObjectTimers list = it.value();
+	this->m_object_timers.erase(it);
+
+	// The links are read before the node is released: the pools reuse the first bytes of a free slot
+	TimerInfo* info = list.timers;
+	while (info) {
+		TimerInfo* next = info->obj_next;
+		this->m_timers.remove(info->timerId);
+		this->releaseTimer(info);
+		info = next;
+	}
+
+	ZeroTimer* timer = list.zero;
+	while (timer) {
+		ZeroTimer* next = timer->obj_next;
+		this->m_zero_timers.remove(timer->timerId);
+		this->releaseZeroTimer(timer);
+		timer = next;
+	}
+
+	return true;
 }
 
 QList<QAbstractEventDispatcher::TimerInfo> EventDispatcherLibUvPrivate::registeredTimers(QObject* object) const
 {
 	QList<QAbstractEventDispatcher::TimerInfo> res;
 
-	TimerHash::ConstIterator it = this->m_timers.constBegin();
-	while (it != this->m_timers.constEnd()) {
-		TimerInfo* info = it.value();
-		if (object == info->object) {
+	ObjectTimerHash::ConstIterator it = this->m_object_timers.constFind(object);
+	if (it == this->m_object_timers.constEnd()) {
+		return res;
+	}
+
+	for (const TimerInfo* info = it.value().timers; info; info = info->obj_next) {
 #if QT_VERSION < 0x050000
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), info->interval);
+		QAbstractEventDispatcher::TimerInfo ti(info->timerId, info->interval);
 #else
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), info->interval, info->type);
+		QAbstractEventDispatcher::TimerInfo ti(info->timerId, info->interval, info->type);
 #endif
-			res.append(ti);
-		}
-
-		++it;
+		res.append(ti);
 	}
 
-	ZeroTimerHash::ConstIterator zit = this->m_zero_timers.constBegin();
-	while (zit != this->m_zero_timers.constEnd()) {
-		const ZeroTimer& data = zit.value();
-		if (object == data.object) {
+	for (const ZeroTimer* timer = it.value().zero; timer; timer = timer->obj_next) {
 #if QT_VERSION < 0x050000
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), 0);
+		QAbstractEventDispatcher::TimerInfo ti(timer->timerId, 0);
 #else
-			QAbstractEventDispatcher::TimerInfo ti(it.key(), 0, Qt::PreciseTimer);
+		QAbstractEventDispatcher::TimerInfo ti(timer->timerId, 0, Qt::PreciseTimer);
 #endif
-			res.append(ti);
-		}
-
-		++zit;
+		res.append(ti);
 	}
 
 	return res;
@@ -307,16 +549,16 @@ int EventDispatcherLibUvPrivate::remainingTime(int timerId) const
 	if (it != this->m_timers.end()) {
 		const TimerInfo* info = it.value();
 
-		const uv_timer_t* tmp = &info->ev;
-		if (uv_is_active(reinterpret_cast<const uv_handle_t*>(tmp))) {
-			uint64_t now  = uv_now(this->m_base);
-			uint64_t when = static_cast<uint64_t>(info->when.tv_sec)*1000 + static_cast<uint64_t>(info->when.tv_usec)/1000;
-
-			if (now > when) {
+		if (this->isTimerArmed(info)) {
+			// info->due is the deadline the timer is armed for, after rounding and grid alignment; it is measured
+			// against the same time base as the one it was computed from. Outside of processEvents() the cached
+			// time may be arbitrarily old
+			const quint64 now = this->m_loop_level ? this->m_now : uv_hrtime();
+			if (now > info->due) {
 				return 0;
 			}
 
-			return static_cast<int>((when - now) * 1000);
+			return static_cast<int>((info->due - now) / NSEC_PER_MSEC);
 		}
 	}
 
@@ -332,34 +574,76 @@ void EventDispatcherLibUvPrivate::timer_callback(
 #endif
 )
 {
-	EventDispatcherLibUvPrivate* self = static_cast<EventDispatcherLibUvPrivate*>(w->loop->data);
-	TimerInfo* info                   = static_cast<TimerInfo*>(w->data);
+	TimerInfo* info = static_cast<TimerInfo*>(w->data);
+	info->disp->timerExpired(info);
+}
+
+void EventDispatcherLibUvPrivate::wheel_callback(
+	uv_timer_t* w
+#if UV_VERSION_MAJOR < 1
+	, int
+#endif
+)
+{
+	EventDispatcherLibUvPrivate* self = static_cast<EventDispatcherLibUvPrivate*>(w->data);
+
+	TimerWheelNode* node = self->m_wheel->advance(uv_now(w->loop));
+	while (node) {
+		TimerWheelNode* next = node->next;
+		self->timerExpired(static_cast<TimerInfo*>(node->data));
+		node = next;
+	}
+
+	self->scheduleWheel();
+}
+
+void EventDispatcherLibUvPrivate::timerExpired(TimerInfo* info)
+{
+	// A grid point some dispatcher has already woken up for costs no extra wake up
+	const quint64 grid = static_cast<quint64>(loadGrid() >> 8) * NSEC_PER_MSEC;
+	if (grid && Qt::PreciseTimer != info->type && !(info->due % grid) && gridPointVisited(static_cast<int>(info->due / grid))) {
+		this->m_stats.grid_saved.add(1);
+	}
 
 	// Timer can be reactivated only after its callback finishes; processEvents() will take care of this
-	PendingEvent event(info->object, new QTimerEvent(info->timerId));
-	self->m_event_list.append(event);
+	PendingEvent event;
+	event.timer  = info;
+	event.socket = 0;
+	event.serial = info->serial;
+	event.events = 0;
+
+	if (this->m_timers_masked) {
+		this->m_deferred_timers.append(event);
+	}
+	else {
+		this->m_event_list.append(event);
+	}
 }
 
 bool EventDispatcherLibUvPrivate::disableTimers(bool disable)
 {
-	struct timeval now;
-	if (!disable) {
-		gettimeofday(&now, 0);
+	// Timers keep running; those expiring while timers are masked are replayed when the mask is lifted
+	if (disable) {
+		if (!this->m_timers_masked++ && this->m_zero_head) {
+			uv_idle_stop(&this->m_zero_idle);
+		}
+
+		return true;
 	}
 
-	TimerHash::Iterator it = this->m_timers.begin();
-	while (it != this->m_timers.end()) {
-		TimerInfo* info = it.value();
-		if (disable) {
-			uv_timer_stop(&info->ev);
-		}
-		else {
-			uint64_t delta = calculateNextTimeout(info, now);
-			uv_timer_t* tmp = &info->ev;
-			uv_timer_start(tmp, &EventDispatcherLibUvPrivate::timer_callback, delta, 0);
-		}
+	Q_ASSERT(this->m_timers_masked > 0);
+	if (--this->m_timers_masked) {
+		return true;
+	}
+
+	for (int i=0; i<this->m_deferred_timers.size(); ++i) {
+		this->m_event_list.append(this->m_deferred_timers.at(i));
+	}
+
+	this->m_deferred_timers.erase(this->m_deferred_timers.begin(), this->m_deferred_timers.end());
 
-		++it;
+	if (this->m_zero_head) {
+		uv_idle_start(&this->m_zero_idle, &EventDispatcherLibUvPrivate::zero_timer_callback);
 	}
 
 	return true;
@@ -370,12 +654,74 @@ void EventDispatcherLibUvPrivate::killTimers(void)
 	if (!this->m_timers.isEmpty()) {
 		TimerHash::Iterator it = this->m_timers.begin();
 		while (it != this->m_timers.end()) {
-			TimerInfo* info = it.value();
-			uv_timer_stop(&info->ev);
-			delete info;
+			this->releaseTimer(it.value());
 			++it;
 		}
 
 		this->m_timers.clear();
 	}
+
+	while (this->m_zero_head) {
+		this->releaseZeroTimer(this->m_zero_head);
+	}
+
+	this->m_zero_timers.clear();
+	this->m_object_timers.clear();
+}
+
+void EventDispatcherLibUvPrivate::releaseTimer(TimerInfo* info)
+{
+	info->serial = 0;
+
+	if (info->wheel) {
+		this->m_wheel->remove(&info->node);
+		this->m_timer_pool.release(info);
+		return;
+	}
+
+#ifdef Q_OS_LINUX
+	if (info->hires) {
+		this->disarmHiResTimer(info);
+	}
+#endif
+
+	// The slot is returned to the pool only after libuv has finished with the handle
+	this->closeHandle(reinterpret_cast<uv_handle_t*>(&info->ev), &EventDispatcherLibUvPrivate::timer_close_callback);
+}
+
+void EventDispatcherLibUvPrivate::releaseZeroTimer(ZeroTimer* timer)
+{
+	for (ZeroTimerCursor* cursor = this->m_zero_cursor; cursor; cursor = cursor->outer) {
+		if (cursor->next == timer) {
+			cursor->next = timer->next;
+		}
+	}
+
+	if (timer->prev) {
+		timer->prev->next = timer->next;
+	}
+	else {
+		this->m_zero_head = timer->next;
+	}
+
+	if (timer->next) {
+		timer->next->prev = timer->prev;
+	}
+	else {
+		this->m_zero_tail = timer->prev;
+	}
+
+	if (!this->m_zero_head) {
+		uv_idle_stop(&this->m_zero_idle);
+	}
+
+	this->m_zero_pool.release(timer);
+}
+
+void EventDispatcherLibUvPrivate::timer_close_callback(uv_handle_t* w)
+{
+	TimerInfo* info                   = static_cast<TimerInfo*>(w->data);
+	EventDispatcherLibUvPrivate* disp = info->disp;
+	disp->m_timer_pool.release(info);
+	disp->handleClosed();
 }
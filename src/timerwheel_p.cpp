@@ -0,0 +1,182 @@
+#include <string.h>
+#include "timerwheel_p.h"
+
+TimerWheel::TimerWheel(quint64 now)
+	: m_current(now), m_overflow(0), m_size(0)
+{
+	memset(this->m_slots, 0, sizeof(this->m_slots));
+	memset(this->m_count, 0, sizeof(this->m_count));
+}
+
+void TimerWheel::insert(TimerWheelNode* node, quint64 expires)
+{
+	Q_ASSERT(!TimerWheel::isActive(node));
+
+	// The slot of the current tick has already been processed
+	node->expires = (expires > this->m_current) ? expires : this->m_current + 1;
+	this->link(node);
+	++this->m_size;
+}
+
+void TimerWheel::remove(TimerWheelNode* node)
+{
+	if (TimerWheel::isActive(node)) {
+		this->unlink(node);
+		--this->m_size;
+	}
+}
+
+TimerWheelNode* TimerWheel::advance(quint64 now)
+{
+	TimerWheelNode* expired = 0;
+	TimerWheelNode** tail   = &expired;
+
+	while (this->m_current < now) {
+		if (!this->m_size) {
+			this->m_current = now;
+			break;
+		}
+
+		quint64 next = this->m_current + 1;
+		if (!this->m_count[0]) {
+			// Nothing to expire before the lowest populated level cascades: skip right to that tick
+			int level = 1;
+			while (level < Levels && !this->m_count[level]) {
+				++level;
+			}
+
+			int shift = level * SlotBits;
+			next      = ((this->m_current >> shift) + 1) << shift;
+			if (next > now) {
+				this->m_current = now;
+				break;
+			}
+		}
+
+		this->m_current = next;
+
+		for (int level=Levels; level>0; --level) {
+			quint64 mask = (Q_UINT64_C(1) << (level * SlotBits)) - 1;
+			if (!(this->m_current & mask)) {
+				this->cascade(level);
+			}
+		}
+
+		TimerWheelNode** slot = &this->m_slots[0][this->m_current & SlotMask];
+		while (*slot) {
+			TimerWheelNode* node = *slot;
+			this->unlink(node);
+			--this->m_size;
+
+			*tail = node;
+			tail  = &node->next;
+		}
+	}
+
+	return expired;
+}
+
+bool TimerWheel::nextExpiry(quint64& when) const
+{
+	if (!this->m_size) {
+		return false;
+	}
+
+	if (this->m_count[0]) {
+		for (int i=(this->m_current & SlotMask) + 1; i<Slots; ++i) {
+			if (this->m_slots[0][i]) {
+				when = (this->m_current & ~quint64(SlotMask)) | quint64(i);
+				return true;
+			}
+		}
+	}
+
+	// Nodes on higher levels expire later than any node on the lower ones
+	const TimerWheelNode* list = 0;
+	for (int level=1; level<Levels && !list; ++level) {
+		if (this->m_count[level]) {
+			for (int i=((this->m_current >> (level * SlotBits)) & SlotMask) + 1; i<Slots; ++i) {
+				if (this->m_slots[level][i]) {
+					list = this->m_slots[level][i];
+					break;
+				}
+			}
+		}
+	}
+
+	if (!list) {
+		list = this->m_overflow;
+	}
+
+	Q_ASSERT(list != 0);
+	when = list->expires;
+	for (list = list->next; list; list = list->next) {
+		if (list->expires < when) {
+			when = list->expires;
+		}
+	}
+
+	return true;
+}
+
+void TimerWheel::link(TimerWheelNode* node)
+{
+	int level = Overflow;
+	int slot  = 0;
+
+	for (int i=0; i<Levels; ++i) {
+		int shift = (i + 1) * SlotBits;
+		if ((node->expires >> shift) == (this->m_current >> shift)) {
+			level = i;
+			slot  = static_cast<int>((node->expires >> (i * SlotBits)) & SlotMask);
+			break;
+		}
+	}
+
+	TimerWheelNode** h = this->head(level, slot);
+	node->level = level;
+	node->slot  = slot;
+	node->prev  = 0;
+	node->next  = *h;
+	if (*h) {
+		(*h)->prev = node;
+	}
+
+	*h = node;
+	++this->m_count[level];
+}
+
+void TimerWheel::unlink(TimerWheelNode* node)
+{
+	if (node->prev) {
+		node->prev->next = node->next;
+	}
+	else {
+		*this->head(node->level, node->slot) = node->next;
+	}
+
+	if (node->next) {
+		node->next->prev = node->prev;
+	}
+
+	--this->m_count[node->level];
+	node->level = -1;
+	node->prev  = 0;
+	node->next  = 0;
+}
+
+void TimerWheel::cascade(int level)
+{
+	int slot = (Overflow == level) ? 0 : static_cast<int>((this->m_current >> (level * SlotBits)) & SlotMask);
+	TimerWheelNode** h = this->head(level, slot);
+
+	TimerWheelNode* node = *h;
+	*h = 0;
+
+	while (node) {
+		TimerWheelNode* next = node->next;
+		--this->m_count[level];
+		this->link(node);
+		node = next;
+	}
+}
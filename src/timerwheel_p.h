@@ -0,0 +1,61 @@
+#ifndef TIMERWHEEL_P_H
+#define TIMERWHEEL_P_H
+
+#include <QtCore/QtGlobal>
+#include "qt4compat.h"
+
+struct TimerWheelNode {
+	TimerWheelNode* prev;
+	TimerWheelNode* next;
+	quint64 expires;
+	void* data;
+	int level; // -1 if the node is not in the wheel
+	int slot;
+};
+
+/*
+ * Hierarchical timing wheel with 1 ms ticks: four levels of 256 slots cover 2^32 ms,
+ * nodes which expire even later are kept in the overflow list and are put back into the wheel
+ * when the top level wraps. Insertion and removal are O(1); a node is moved to a lower level
+ * at most once per level, when the wheel reaches the start of its slot.
+ */
+class Q_DECL_HIDDEN TimerWheel {
+public:
+	explicit TimerWheel(quint64 now);
+
+	void insert(TimerWheelNode* node, quint64 expires);
+	void remove(TimerWheelNode* node);
+	static bool isActive(const TimerWheelNode* node) { return node->level >= 0; }
+
+	// Returns the expired nodes chained through their next pointers; they are no longer in the wheel
+	TimerWheelNode* advance(quint64 now);
+
+	// Earliest tick when advance() has something to do; returns false if the wheel is empty
+	bool nextExpiry(quint64& when) const;
+
+	bool isEmpty(void) const { return !this->m_size; }
+
+private:
+	Q_DISABLE_COPY(TimerWheel)
+
+	enum {
+		Levels   = 4,
+		SlotBits = 8,
+		Slots    = 1 << SlotBits,
+		SlotMask = Slots - 1,
+		Overflow = Levels
+	};
+
+	quint64 m_current;
+	TimerWheelNode* m_slots[Levels][Slots];
+	TimerWheelNode* m_overflow;
+	int m_count[Levels + 1];
+	int m_size;
+
+	TimerWheelNode** head(int level, int slot) { return (Overflow == level) ? &this->m_overflow : &this->m_slots[level][slot]; }
+	void link(TimerWheelNode* node);
+	void unlink(TimerWheelNode* node);
+	void cascade(int level);
+};
+
+#endif // TIMERWHEEL_P_H
@@ -0,0 +1,145 @@
+#include <QtCore/QByteArray>
+#include <QtCore/QThread>
+#include "eventdispatcher_libuv_p.h"
+
+namespace {
+
+#if QT_VERSION >= 0x040400
+	enum {
+		PoolIdle,     // nothing has used the thread pool yet
+		PoolSizing,   // setThreadPoolSize() is changing the environment
+		PoolStarted   // the thread pool may be running; its size can no longer be changed
+	};
+
+	static QAtomicInt pool_state(PoolIdle);
+
+	class QueueWorkTask : public EventDispatcherLibUv::Task {
+	public:
+		QueueWorkTask(EventDispatcherLibUvPrivate* d, EventDispatcherLibUv::Work* work)
+			: EventDispatcherLibUv::Task(), m_d(d), m_work(work)
+		{
+		}
+
+		virtual void run(void) { this->m_d->queueWork(this->m_work); }
+
+	private:
+		EventDispatcherLibUvPrivate* m_d;
+		EventDispatcherLibUv::Work* m_work;
+	};
+#else
+	static bool pool_started = false;
+#endif
+
+}
+
+void EventDispatcherLibUvPrivate::threadPoolUsed(void)
+{
+#if QT_VERSION >= 0x040400
+	// libuv reads UV_THREADPOOL_SIZE on the first use of the pool; that must not overlap with qputenv()
+	for (;;) {
+		const int state = pool_state.fetchAndAddRelaxed(0);
+		if (PoolStarted == state || (PoolIdle == state && pool_state.testAndSetOrdered(PoolIdle, PoolStarted))) {
+			return;
+		}
+
+		QThread::yieldCurrentThread();
+	}
+#else
+	pool_started = true;
+#endif
+}
+
+#if QT_VERSION >= 0x040400
+void EventDispatcherLibUvPrivate::queueRemoteWork(EventDispatcherLibUv::Work* work)
+{
+	// uv_queue_work() may only be called from the loop's thread
+	this->postTask(new QueueWorkTask(this, work));
+}
+#endif
+
+void EventDispatcherLibUvPrivate::queueWork(EventDispatcherLibUv::Work* work)
+{
+	EventDispatcherLibUvPrivate::threadPoolUsed();
+
+	WorkRequest* r = this->m_work_pool.allocate();
+	r->disp        = this;
+	r->work        = work;
+	r->req.data    = r;
+
+	uv_queue_work(this->m_base, &r->req, &EventDispatcherLibUvPrivate::work_callback, &EventDispatcherLibUvPrivate::after_work_callback);
+	++this->m_work_count;
+}
+
+bool EventDispatcherLibUvPrivate::setThreadPoolSize(int size)
+{
+	if (size < 1) {
+		return false;
+	}
+
+#if QT_VERSION >= 0x040400
+	if (!pool_state.testAndSetOrdered(PoolIdle, PoolSizing)) {
+		return false;
+	}
+
+	bool res = qputenv("UV_THREADPOOL_SIZE", QByteArray::number(size));
+	pool_state.fetchAndStoreOrdered(PoolIdle);
+	return res;
+#else
+	return !pool_started && qputenv("UV_THREADPOOL_SIZE", QByteArray::number(size));
+#endif
+}
+
+bool EventDispatcherLibUvPrivate::finishWork(void)
+{
+	bool result = false;
+
+	while (this->m_done_head) {
+		EventDispatcherLibUv::Work* work = this->m_done_head;
+		this->m_done_head = work->m_next;
+		if (!this->m_done_head) {
+			this->m_done_tail = 0;
+		}
+
+		work->finish();
+		delete work;
+		result = true;
+	}
+
+	return result;
+}
+
+void EventDispatcherLibUvPrivate::work_callback(uv_work_t* req)
+{
+	WorkRequest* r = static_cast<WorkRequest*>(req->data);
+	r->work->execute();
+}
+
+void EventDispatcherLibUvPrivate::after_work_callback(uv_work_t* req, int status)
+{
+	WorkRequest* r                    = static_cast<WorkRequest*>(req->data);
+	EventDispatcherLibUvPrivate* disp = r->disp;
+	EventDispatcherLibUv::Work* work  = r->work;
+
+	// The only error libuv reports here is cancellation
+	work->m_cancelled = (0 != status);
+	work->m_next      = 0;
+	disp->m_work_pool.release(r);
+
+	if (Q_UNLIKELY(disp->m_detached)) {
+		// Nothing will collect the completed work any more
+		work->finish();
+		delete work;
+	}
+	else {
+		if (disp->m_done_tail) {
+			disp->m_done_tail->m_next = work;
+		}
+		else {
+			disp->m_done_head = work;
+		}
+
+		disp->m_done_tail = work;
+	}
+
+	disp->requestFinished();
+}
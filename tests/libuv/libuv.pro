@@ -0,0 +1,17 @@
+TEMPLATE = subdirs
+
+SUBDIRS = \
+	tst_masking \
+	tst_remotetimers \
+	tst_asyncfile \
+	tst_tcpsocket \
+	tst_process \
+	tst_fswatcher \
+	tst_budget \
+	tst_timerindex \
+	tst_threadgroup \
+	tst_threadpool \
+	tst_hostdriven \
+	tst_timerwheel \
+	tst_signals \
+	tst_loophooks
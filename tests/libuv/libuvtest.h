@@ -0,0 +1,94 @@
+#ifndef LIBUVTEST_H
+#define LIBUVTEST_H
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QList>
+#include <QtTest/QtTest>
+#ifdef Q_OS_UNIX
+#	include <unistd.h>
+#endif
+#include "eventdispatcher_libuv.h"
+
+#if QT_VERSION >= 0x050000
+#	define LIBUV_SKIP(msg) QSKIP(msg)
+#else
+#	define LIBUV_SKIP(msg) QSKIP(msg, SkipSingle)
+#endif
+
+// QAbstractEventDispatcher::TimerInfo is a QPair<int, int> before Qt 5
+#if QT_VERSION >= 0x050000
+#	define LIBUV_TIMER_ID(info) ((info).timerId)
+#else
+#	define LIBUV_TIMER_ID(info) ((info).first)
+#endif
+
+// Runs the event loop until expr holds, for at most five seconds
+#define LIBUV_TRY_VERIFY(expr) \
+	do { \
+		for (int i_ = 0; i_ < 500 && !(expr); ++i_) { \
+			QTest::qWait(10); \
+		} \
+		QVERIFY(expr); \
+	} while (0)
+
+#define LIBUV_TRY_COMPARE(expr, expected) \
+	do { \
+		for (int i_ = 0; i_ < 500 && !((expr) == (expected)); ++i_) { \
+			QTest::qWait(10); \
+		} \
+		QCOMPARE(expr, expected); \
+	} while (0)
+
+// Records the ids of the timer events it gets, in delivery order
+class TimerRecorder : public QObject {
+	Q_OBJECT
+public:
+	QList<int> fired;
+
+protected:
+	virtual void timerEvent(QTimerEvent* event)
+	{
+		this->fired.append(event->timerId());
+	}
+};
+
+// Records the descriptors of the notifier activations it gets; reads one byte so that the descriptor is drained
+class NotifierRecorder : public QObject {
+	Q_OBJECT
+public:
+	QList<int> fired;
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		this->fired.append(fd);
+#ifdef Q_OS_UNIX
+		char c;
+		ssize_t n = ::read(fd, &c, 1);
+		Q_UNUSED(n)
+#endif
+	}
+};
+
+// QTEST_APPLESS_MAIN with EventDispatcherLibUv installed as the main thread's dispatcher
+#if QT_VERSION >= 0x050000
+#	define LIBUV_TEST_MAIN(TestObject) \
+		int main(int argc, char** argv) \
+		{ \
+			QCoreApplication::setEventDispatcher(new EventDispatcherLibUv()); \
+			QCoreApplication app(argc, argv); \
+			TestObject tc; \
+			return QTest::qExec(&tc, argc, argv); \
+		}
+#else
+#	define LIBUV_TEST_MAIN(TestObject) \
+		int main(int argc, char** argv) \
+		{ \
+			EventDispatcherLibUv dispatcher; \
+			QCoreApplication app(argc, argv); \
+			TestObject tc; \
+			return QTest::qExec(&tc, argc, argv); \
+		}
+#endif
+
+#endif // LIBUVTEST_H
@@ -0,0 +1,16 @@
+QT      -= gui
+QT      += testlib
+CONFIG  += console testcase
+CONFIG  -= app_bundle
+DESTDIR  = ../..
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+HEADERS     += $$PWD/libuvtest.h
+
+include(../local.pri)
+
+unix:system('pkg-config --exists libuv') {
+	CONFIG    += link_pkgconfig
+	PKGCONFIG += libuv
+}
@@ -0,0 +1,165 @@
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QPointer>
+#include <QtCore/QString>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+#include <uv.h>
+#include "asyncfile_libuv.h"
+#include "libuvtest.h"
+
+// Deletes whatever emitted the signal it is connected to
+class SenderDeleter : public QObject {
+	Q_OBJECT
+public:
+	SenderDeleter(void) : QObject(), calls(0) {}
+
+	int calls;
+
+public Q_SLOTS:
+	void deleteSender(void)
+	{
+		++this->calls;
+		delete this->sender();
+	}
+};
+
+class tst_AsyncFile : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void init(void);
+	void cleanup(void);
+	void writeThenRead(void);
+	void concurrentOpen(void);
+	void deletedFromChunkRead(void);
+
+private:
+	QString m_path;
+};
+
+void tst_AsyncFile::init(void)
+{
+	this->m_path = QDir::tempPath() + QLatin1String("/tst_asyncfile.") + QString::number(QCoreApplication::applicationPid());
+	QFile::remove(this->m_path);
+}
+
+void tst_AsyncFile::cleanup(void)
+{
+	QFile::remove(this->m_path);
+}
+
+void tst_AsyncFile::writeThenRead(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	const QByteArray data("hello world");
+
+	{
+		AsyncFileLibUv file;
+		QSignalSpy opened(&file, SIGNAL(opened(int)));
+		QSignalSpy written(&file, SIGNAL(writeFinished(qint64,qint64,int)));
+		QSignalSpy closed(&file, SIGNAL(closed(int)));
+
+		file.open(this->m_path, QIODevice::WriteOnly);
+		LIBUV_TRY_COMPARE(opened.count(), 1);
+		QCOMPARE(opened.at(0).at(0).toInt(), 0);
+		QVERIFY(file.isOpen());
+
+		file.write(0, data);
+		LIBUV_TRY_COMPARE(written.count(), 1);
+		QCOMPARE(written.at(0).at(0).toLongLong(), Q_INT64_C(0));
+		QCOMPARE(written.at(0).at(1).toLongLong(), static_cast<qint64>(data.size()));
+		QCOMPARE(written.at(0).at(2).toInt(), 0);
+
+		file.close();
+		LIBUV_TRY_COMPARE(closed.count(), 1);
+		QCOMPARE(closed.at(0).at(0).toInt(), 0);
+		QVERIFY(!file.isOpen());
+	}
+
+	AsyncFileLibUv file;
+	QSignalSpy opened(&file, SIGNAL(opened(int)));
+	QSignalSpy read(&file, SIGNAL(readFinished(qint64,QByteArray,int)));
+
+	file.open(this->m_path, QIODevice::ReadOnly);
+	LIBUV_TRY_COMPARE(opened.count(), 1);
+	QCOMPARE(opened.at(0).at(0).toInt(), 0);
+
+	// Reads issued together complete in any order; each one reports its own offset
+	file.read(6, 5);
+	file.read(0, 64);
+	LIBUV_TRY_COMPARE(read.count(), 2);
+
+	for (int i=0; i<read.count(); ++i) {
+		const qint64 offset = read.at(i).at(0).toLongLong();
+		QCOMPARE(read.at(i).at(2).toInt(), 0);
+		QCOMPARE(read.at(i).at(1).toByteArray(), (offset ? QByteArray("world") : data));
+	}
+
+	QVERIFY(read.at(0).at(0).toLongLong() != read.at(1).at(0).toLongLong());
+#else
+	LIBUV_SKIP("AsyncFileLibUv requires libuv 1.0+");
+#endif
+}
+
+void tst_AsyncFile::concurrentOpen(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	QFile f(this->m_path);
+	QVERIFY(f.open(QIODevice::WriteOnly));
+	f.close();
+
+	AsyncFileLibUv file;
+	QSignalSpy opened(&file, SIGNAL(opened(int)));
+
+	// The second open() is refused while the first one is in flight; the first one is not disturbed
+	file.open(this->m_path, QIODevice::ReadOnly);
+	file.open(this->m_path, QIODevice::ReadOnly);
+	LIBUV_TRY_COMPARE(opened.count(), 2);
+
+	QList<int> results;
+	results << opened.at(0).at(0).toInt() << opened.at(1).at(0).toInt();
+	QCOMPARE(results.count(0), 1);
+	QCOMPARE(results.count(UV_EBUSY), 1);
+	QVERIFY(file.isOpen());
+
+	// Still refused once the file is open
+	file.open(this->m_path, QIODevice::ReadOnly);
+	LIBUV_TRY_COMPARE(opened.count(), 3);
+	QCOMPARE(opened.at(2).at(0).toInt(), static_cast<int>(UV_EBUSY));
+	QVERIFY(file.isOpen());
+#else
+	LIBUV_SKIP("AsyncFileLibUv requires libuv 1.0+");
+#endif
+}
+
+void tst_AsyncFile::deletedFromChunkRead(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	QFile f(this->m_path);
+	QVERIFY(f.open(QIODevice::WriteOnly));
+	QCOMPARE(f.write(QByteArray(4 * 4096, 'x')), Q_INT64_C(4 * 4096));
+	f.close();
+
+	QPointer<AsyncFileLibUv> file = new AsyncFileLibUv;
+	QSignalSpy opened(file, SIGNAL(opened(int)));
+	file->open(this->m_path, QIODevice::ReadOnly);
+	LIBUV_TRY_COMPARE(opened.count(), 1);
+	QCOMPARE(opened.at(0).at(0).toInt(), 0);
+
+	// Chunks already read are still queued for delivery when the slot destroys the file
+	SenderDeleter deleter;
+	QObject::connect(file, SIGNAL(chunkRead(qint64,QByteArray)), &deleter, SLOT(deleteSender()));
+	file->startStreaming(0, 4096, 4);
+
+	LIBUV_TRY_VERIFY(file.isNull());
+	QTest::qWait(50);
+	QCOMPARE(deleter.calls, 1);
+#else
+	LIBUV_SKIP("AsyncFileLibUv requires libuv 1.0+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_AsyncFile)
+
+#include "tst_asyncfile.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_asyncfile
+SOURCES += tst_asyncfile.cpp
+
+include(../libuvtest.pri)
@@ -0,0 +1,152 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtCore/QSocketNotifier>
+#include <QtTest/QtTest>
+#ifdef Q_OS_UNIX
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+#include "libuvtest.h"
+
+/*
+ * A dispatch budget caps the activations one processEvents() call delivers; the rest are carried over to the next
+ * call, which delivers them first, in their original order, and does not block.
+ */
+class tst_Budget : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void cleanup(void);
+	void timersCarriedOverInExpiryOrder(void);
+	void carriedOverWithoutBlocking(void);
+	void socketActivationsCarriedOverOnce(void);
+};
+
+void tst_Budget::cleanup(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	EventDispatcherLibUv::DispatchBudget none = { 0, 0 };
+	disp->setDispatchBudget(EventDispatcherLibUv::TimerActivations, none);
+	disp->setDispatchBudget(EventDispatcherLibUv::SocketActivations, none);
+}
+
+void tst_Budget::timersCarriedOverInExpiryOrder(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder obj;
+	const int third  = obj.startTimer(30);
+	const int first  = obj.startTimer(10);
+	const int second = obj.startTimer(20);
+	QTest::qSleep(50);
+
+	EventDispatcherLibUv::DispatchBudget budget = { 1, 0 };
+	disp->setDispatchBudget(EventDispatcherLibUv::TimerActivations, budget);
+	QCOMPARE(disp->dispatchBudget(EventDispatcherLibUv::TimerActivations).maxActivations, 1);
+	disp->resetStatistics();
+
+	// One activation per call, the two others wait for the following calls
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 1);
+	QCOMPARE(obj.fired.at(0), first);
+	QCOMPARE(disp->statistics().carriedOver, Q_UINT64_C(2));
+	QCOMPARE(disp->statistics().timerActivations, Q_UINT64_C(1));
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 2);
+	QCOMPARE(obj.fired.at(1), second);
+	QCOMPARE(disp->statistics().carriedOver, Q_UINT64_C(3));
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 3);
+	QCOMPARE(obj.fired.at(2), third);
+	QCOMPARE(disp->statistics().carriedOver, Q_UINT64_C(3));
+	QCOMPARE(disp->statistics().timerActivations, Q_UINT64_C(3));
+
+	obj.killTimer(first);
+	obj.killTimer(second);
+	obj.killTimer(third);
+}
+
+void tst_Budget::carriedOverWithoutBlocking(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder obj;
+	TimerRecorder guard;
+	const int a = obj.startTimer(10);
+	const int b = obj.startTimer(10);
+	QTest::qSleep(20);
+
+	EventDispatcherLibUv::DispatchBudget budget = { 1, 0 };
+	disp->setDispatchBudget(EventDispatcherLibUv::TimerActivations, budget);
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 1);
+
+	// Only the guard would end a blocking wait: the carried activation must come first
+	const int g = guard.startTimer(1000);
+	disp->processEvents(QEventLoop::WaitForMoreEvents);
+	QCOMPARE(obj.fired.size(), 2);
+	QCOMPARE(obj.fired.count(a), 1);
+	QCOMPARE(obj.fired.count(b), 1);
+	QVERIFY(guard.fired.isEmpty());
+
+	guard.killTimer(g);
+	obj.killTimer(a);
+	obj.killTimer(b);
+}
+
+void tst_Budget::socketActivationsCarriedOverOnce(void)
+{
+#ifdef Q_OS_UNIX
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	int p1[2];
+	int p2[2];
+	QCOMPARE(::socketpair(AF_UNIX, SOCK_STREAM, 0, p1), 0);
+	QCOMPARE(::socketpair(AF_UNIX, SOCK_STREAM, 0, p2), 0);
+
+	NotifierRecorder recorder;
+	QSocketNotifier n1(p1[0], QSocketNotifier::Read);
+	QSocketNotifier n2(p2[0], QSocketNotifier::Read);
+	QObject::connect(&n1, SIGNAL(activated(int)), &recorder, SLOT(activated(int)));
+	QObject::connect(&n2, SIGNAL(activated(int)), &recorder, SLOT(activated(int)));
+
+	EventDispatcherLibUv::DispatchBudget budget = { 1, 0 };
+	disp->setDispatchBudget(EventDispatcherLibUv::SocketActivations, budget);
+	disp->resetStatistics();
+
+	QCOMPARE(::write(p1[1], "x", 1), static_cast<ssize_t>(1));
+	QCOMPARE(::write(p2[1], "x", 1), static_cast<ssize_t>(1));
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(recorder.fired.size(), 1);
+	QCOMPARE(disp->statistics().carriedOver, Q_UINT64_C(1));
+
+	// The watcher still reports the carried descriptor; it must not be queued a second time
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(recorder.fired.size(), 2);
+	QCOMPARE(recorder.fired.count(p1[0]), 1);
+	QCOMPARE(recorder.fired.count(p2[0]), 1);
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(recorder.fired.size(), 2);
+	QCOMPARE(disp->statistics().socketActivations, Q_UINT64_C(2));
+
+	n1.setEnabled(false);
+	n2.setEnabled(false);
+	::close(p1[0]);
+	::close(p1[1]);
+	::close(p2[0]);
+	::close(p2[1]);
+#else
+	LIBUV_SKIP("This test requires a Unix system");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_Budget)
+
+#include "tst_budget.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_budget
+SOURCES += tst_budget.cpp
+
+include(../libuvtest.pri)
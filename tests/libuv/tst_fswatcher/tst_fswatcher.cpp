@@ -0,0 +1,125 @@
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+#include <uv.h>
+#include "fswatcher_libuv.h"
+#include "libuvtest.h"
+
+#if UV_VERSION_MAJOR >= 1
+namespace {
+
+	bool append(const QString& path, const char* data)
+	{
+		QFile f(path);
+		if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+			return false;
+		}
+
+		bool res = f.write(QByteArray(data)) > 0;
+		f.close();
+		return res;
+	}
+
+}
+#endif
+
+class tst_FileSystemWatcher : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void init(void);
+	void cleanup(void);
+	void fileChangesCoalesced(void);
+	void directoryEntriesCoalesced(void);
+
+private:
+	QString m_dir;
+};
+
+void tst_FileSystemWatcher::init(void)
+{
+	this->m_dir = QDir::tempPath() + QLatin1String("/tst_fswatcher.") + QString::number(QCoreApplication::applicationPid());
+	QVERIFY(QDir().mkpath(this->m_dir));
+}
+
+void tst_FileSystemWatcher::cleanup(void)
+{
+	QDir dir(this->m_dir);
+	QStringList entries = dir.entryList(QDir::Files);
+	for (int i=0; i<entries.size(); ++i) {
+		dir.remove(entries.at(i));
+	}
+
+	QDir().rmdir(this->m_dir);
+}
+
+void tst_FileSystemWatcher::fileChangesCoalesced(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	const QString path = this->m_dir + QLatin1String("/file");
+	QVERIFY(append(path, "0"));
+
+	FileSystemWatcherLibUv watcher;
+	QSignalSpy changed(&watcher, SIGNAL(pathsChanged(QStringList)));
+	watcher.setCoalescingWindow(300);
+	QVERIFY(watcher.addPath(path));
+
+	// Spread over several loop iterations, all within the window that opens with the first change
+	for (int i=0; i<5; ++i) {
+		QVERIFY(append(path, "x"));
+		QTest::qWait(10);
+	}
+
+	QCOMPARE(changed.count(), 0);
+
+	LIBUV_TRY_COMPARE(changed.count(), 1);
+	QCOMPARE(changed.at(0).at(0).toStringList(), QStringList() << path);
+
+	// Nothing is left over for a second delivery
+	QTest::qWait(400);
+	QCOMPARE(changed.count(), 1);
+
+	QVERIFY(append(path, "y"));
+	LIBUV_TRY_COMPARE(changed.count(), 2);
+	QCOMPARE(changed.at(1).at(0).toStringList(), QStringList() << path);
+#else
+	LIBUV_SKIP("FileSystemWatcherLibUv requires libuv 1.0+");
+#endif
+}
+
+void tst_FileSystemWatcher::directoryEntriesCoalesced(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	const QString a = this->m_dir + QLatin1String("/a");
+	const QString b = this->m_dir + QLatin1String("/b");
+
+	FileSystemWatcherLibUv watcher;
+	QSignalSpy changed(&watcher, SIGNAL(pathsChanged(QStringList)));
+	watcher.setCoalescingWindow(300);
+	QVERIFY(watcher.addPath(this->m_dir));
+
+	QVERIFY(append(a, "1"));
+	QTest::qWait(10);
+	QVERIFY(append(b, "1"));
+	QTest::qWait(10);
+	QVERIFY(append(a, "2"));
+
+	// One delivery, each changed entry listed once
+	LIBUV_TRY_COMPARE(changed.count(), 1);
+	QStringList paths = changed.at(0).at(0).toStringList();
+	QCOMPARE(paths.size(), 2);
+	QCOMPARE(paths.count(a), 1);
+	QCOMPARE(paths.count(b), 1);
+
+	QTest::qWait(400);
+	QCOMPARE(changed.count(), 1);
+#else
+	LIBUV_SKIP("FileSystemWatcherLibUv requires libuv 1.0+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_FileSystemWatcher)
+
+#include "tst_fswatcher.moc"
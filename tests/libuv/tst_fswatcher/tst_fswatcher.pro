@@ -0,0 +1,4 @@
+TARGET   = tst_fswatcher
+SOURCES += tst_fswatcher.cpp
+
+include(../libuvtest.pri)
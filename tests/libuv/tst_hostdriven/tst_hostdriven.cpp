@@ -0,0 +1,231 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#ifdef Q_OS_UNIX
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+#include "libuvtest.h"
+
+// Counts what the dispatcher delivers, and whether the host's prepare callback has run in the same loop iteration
+class HostReceiver : public QObject {
+	Q_OBJECT
+public:
+	HostReceiver(const bool* after_prepare, bool nest)
+		: QObject(), timers(0), events(0), notifiers(0), misplaced(0), nested(true), m_after_prepare(after_prepare), m_nest(nest)
+	{
+	}
+
+	int timers;
+	int events;
+	int notifiers;
+	int misplaced; // deliveries before the poll phase, or outside of the host's uv_run()
+	bool nested;   // what the nested processEvents() returned
+
+	bool done(void) const
+	{
+#ifdef Q_OS_UNIX
+		return this->timers && this->events && this->notifiers;
+#else
+		return this->timers && this->events;
+#endif
+	}
+
+public Q_SLOTS:
+	void activated(int fd)
+	{
+		++this->notifiers;
+		this->check();
+#ifdef Q_OS_UNIX
+		char c;
+		ssize_t n = ::read(fd, &c, 1);
+		Q_UNUSED(n)
+#else
+		Q_UNUSED(fd)
+#endif
+	}
+
+protected:
+	virtual void timerEvent(QTimerEvent* event)
+	{
+		Q_UNUSED(event)
+		++this->timers;
+		this->check();
+	}
+
+	virtual void customEvent(QEvent* event)
+	{
+		Q_UNUSED(event)
+		++this->events;
+		this->check();
+		if (this->m_nest) {
+			this->nested = QAbstractEventDispatcher::instance()->processEvents(QEventLoop::AllEvents);
+		}
+	}
+
+private:
+	const bool* m_after_prepare;
+	bool m_nest;
+
+	void check(void)
+	{
+		if (!*this->m_after_prepare) {
+			++this->misplaced;
+		}
+	}
+};
+
+#if UV_VERSION_MAJOR >= 1 && QT_VERSION >= 0x050000
+namespace {
+
+	// Runs a host driven dispatcher on a loop it drives itself; Qt's processEvents() is never called from here
+	class HostThread : public QThread {
+	public:
+		explicit HostThread(bool nest)
+			: QThread(), host_driven(false), after_prepare(false), timers(0), events(0), notifiers(0), misplaced(0),
+			  nested(true), m_nest(nest)
+		{
+			uv_loop_init(&this->loop);
+			EventDispatcherLibUv* disp = new EventDispatcherLibUv(&this->loop, 0);
+			disp->setHostDriven(true);
+			this->setEventDispatcher(disp);
+		}
+
+		uv_loop_t loop;
+		bool host_driven;
+		bool after_prepare;
+		int timers;
+		int events;
+		int notifiers;
+		int misplaced;
+		bool nested;
+
+	protected:
+		virtual void run(void)
+		{
+			this->host_driven = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance())->isHostDriven();
+
+			HostReceiver receiver(&this->after_prepare, this->m_nest);
+			const int id = receiver.startTimer(10);
+			QCoreApplication::postEvent(&receiver, new QEvent(QEvent::User));
+
+#ifdef Q_OS_UNIX
+			int fds[2];
+			if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+				return;
+			}
+
+			QSocketNotifier* notifier = new QSocketNotifier(fds[0], QSocketNotifier::Read);
+			QObject::connect(notifier, SIGNAL(activated(int)), &receiver, SLOT(activated(int)));
+			ssize_t n = ::write(fds[1], "x", 1);
+			Q_UNUSED(n)
+#endif
+
+			// Libuv runs the prepare handles right before the poll phase, and the dispatcher's check handle right after it
+			uv_prepare_t prepare;
+			uv_prepare_init(&this->loop, &prepare);
+			prepare.data = this;
+			uv_prepare_start(&prepare, &HostThread::prepare_callback);
+
+			// The timer keeps waking the loop up
+			for (int i=0; i<500 && !receiver.done(); ++i) {
+				this->after_prepare = false;
+				uv_run(&this->loop, UV_RUN_ONCE);
+			}
+
+			// Nothing is delivered outside of uv_run()
+			this->after_prepare = false;
+
+			receiver.killTimer(id);
+			uv_close(reinterpret_cast<uv_handle_t*>(&prepare), 0);
+			uv_run(&this->loop, UV_RUN_NOWAIT);
+
+#ifdef Q_OS_UNIX
+			delete notifier;
+			::close(fds[0]);
+			::close(fds[1]);
+#endif
+
+			this->timers    = receiver.timers;
+			this->events    = receiver.events;
+			this->notifiers = receiver.notifiers;
+			this->misplaced = receiver.misplaced;
+			this->nested    = receiver.nested;
+		}
+
+	private:
+		bool m_nest;
+
+		static void prepare_callback(uv_prepare_t* w)
+		{
+			static_cast<HostThread*>(w->data)->after_prepare = true;
+		}
+	};
+
+	// The thread has deleted its dispatcher; the handles it has closed are released by the host's next uv_run()
+	int closeLoop(HostThread& thread)
+	{
+		uv_run(&thread.loop, UV_RUN_NOWAIT);
+		return uv_loop_close(&thread.loop);
+	}
+
+}
+#endif
+
+/*
+ * The dispatcher runs on a loop owned and run by the thread itself; Qt only gets to deliver from the loop's
+ * check phase. Needs setEventDispatcher() to give the thread such a dispatcher.
+ */
+class tst_HostDriven : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void dispatchFromCheckPhase(void);
+	void nestedEventLoop(void);
+};
+
+void tst_HostDriven::dispatchFromCheckPhase(void)
+{
+#if UV_VERSION_MAJOR >= 1 && QT_VERSION >= 0x050000
+	HostThread thread(false);
+	thread.start();
+	QVERIFY(thread.wait());
+
+	QVERIFY(thread.host_driven);
+	QVERIFY(thread.timers > 0);
+	QCOMPARE(thread.events, 1);
+#ifdef Q_OS_UNIX
+	QCOMPARE(thread.notifiers, 1);
+#endif
+	QCOMPARE(thread.misplaced, 0);
+
+	// Every handle of the dispatcher has been closed through the host's loop
+	QCOMPARE(closeLoop(thread), 0);
+#else
+	LIBUV_SKIP("This test requires Qt 5 and libuv 1.0+");
+#endif
+}
+
+void tst_HostDriven::nestedEventLoop(void)
+{
+#if UV_VERSION_MAJOR >= 1 && QT_VERSION >= 0x050000
+	QTest::ignoreMessage(QtWarningMsg, "EventDispatcherLibUv: nested event loops are not supported in host driven mode");
+
+	HostThread thread(true);
+	thread.start();
+	QVERIFY(thread.wait());
+
+	// The nested call returns at once; the outer delivery goes on
+	QCOMPARE(thread.events, 1);
+	QVERIFY(!thread.nested);
+	QVERIFY(thread.timers > 0);
+	QCOMPARE(thread.misplaced, 0);
+	QCOMPARE(closeLoop(thread), 0);
+#else
+	LIBUV_SKIP("This test requires Qt 5 and libuv 1.0+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_HostDriven)
+
+#include "tst_hostdriven.moc"
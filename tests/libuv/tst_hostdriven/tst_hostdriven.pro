@@ -0,0 +1,4 @@
+TARGET   = tst_hostdriven
+SOURCES += tst_hostdriven.cpp
+
+include(../libuvtest.pri)
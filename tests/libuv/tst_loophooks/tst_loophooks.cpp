@@ -0,0 +1,154 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtTest/QtTest>
+#include "libuvtest.h"
+
+namespace {
+
+	struct PhaseRecord {
+		QList<int>* log;
+		int phase;
+	};
+
+	void recordPhase(void* data)
+	{
+		PhaseRecord* r = static_cast<PhaseRecord*>(data);
+		r->log->append(r->phase);
+	}
+
+	void countCalls(void* data)
+	{
+		++*static_cast<int*>(data);
+	}
+
+	// Removes the hook with the given id, which may be its own, on the first call
+	struct Remover {
+		EventDispatcherLibUv* disp;
+		int id;
+		int calls;
+		bool removed;
+	};
+
+	void removeHook(void* data)
+	{
+		Remover* r = static_cast<Remover*>(data);
+		if (!r->calls++) {
+			r->removed = r->disp->removeLoopHook(r->id);
+		}
+	}
+
+}
+
+/*
+ * Hooks run from libuv's idle, prepare and check phases of every loop iteration; in that order within one
+ * iteration, and never again once removed, even when the removal happens from a hook.
+ */
+class tst_LoopHooks : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void phasesInIterationOrder(void);
+	void removeFromHook(void);
+	void idleHookKeepsLoopAwake(void);
+};
+
+void tst_LoopHooks::phasesInIterationOrder(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	QCOMPARE(disp->addLoopHook(EventDispatcherLibUv::Idle, 0, 0), 0);
+
+	QList<int> log;
+	PhaseRecord before = { &log, EventDispatcherLibUv::BeforePoll };
+	PhaseRecord after  = { &log, EventDispatcherLibUv::AfterPoll };
+	PhaseRecord idle   = { &log, EventDispatcherLibUv::Idle };
+
+	// Added out of order on purpose
+	const int a = disp->addLoopHook(EventDispatcherLibUv::AfterPoll, recordPhase, &after);
+	const int b = disp->addLoopHook(EventDispatcherLibUv::BeforePoll, recordPhase, &before);
+	const int i = disp->addLoopHook(EventDispatcherLibUv::Idle, recordPhase, &idle);
+	QVERIFY(a > 0 && b > 0 && i > 0);
+	QVERIFY(a != b && b != i && a != i);
+
+	disp->processEvents(QEventLoop::AllEvents);
+
+	QList<int> expected;
+	expected << EventDispatcherLibUv::Idle << EventDispatcherLibUv::BeforePoll << EventDispatcherLibUv::AfterPoll;
+	QCOMPARE(log, expected);
+
+	QVERIFY(disp->removeLoopHook(a));
+	QVERIFY(disp->removeLoopHook(b));
+	QVERIFY(disp->removeLoopHook(i));
+	QVERIFY(!disp->removeLoopHook(a));
+
+	disp->processEvents(QEventLoop::AllEvents);
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(log, expected);
+}
+
+void tst_LoopHooks::removeFromHook(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	// A hook removing itself
+	Remover self = { disp, 0, 0, false };
+	self.id      = disp->addLoopHook(EventDispatcherLibUv::BeforePoll, removeHook, &self);
+	QVERIFY(self.id > 0);
+
+	// A hook removing another one of the same phase, which may or may not have run in that iteration already
+	int victim_calls = 0;
+	const int victim = disp->addLoopHook(EventDispatcherLibUv::AfterPoll, countCalls, &victim_calls);
+	Remover other    = { disp, victim, 0, false };
+	const int killer = disp->addLoopHook(EventDispatcherLibUv::AfterPoll, removeHook, &other);
+	QVERIFY(victim > 0 && killer > 0);
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(self.calls, 1);
+	QVERIFY(self.removed);
+	QCOMPARE(other.calls, 1);
+	QVERIFY(other.removed);
+	QVERIFY(victim_calls <= 1);
+
+	const int calls = victim_calls;
+	for (int n=0; n<5; ++n) {
+		disp->processEvents(QEventLoop::AllEvents);
+	}
+
+	QCOMPARE(self.calls, 1);
+	QCOMPARE(victim_calls, calls);
+	QCOMPARE(other.calls, 6);
+
+	QVERIFY(!disp->removeLoopHook(self.id));
+	QVERIFY(!disp->removeLoopHook(victim));
+	QVERIFY(disp->removeLoopHook(killer));
+}
+
+void tst_LoopHooks::idleHookKeepsLoopAwake(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	// Only there to end the wait if the loop blocks after all
+	TimerRecorder timeout;
+	const int timer = timeout.startTimer(1000);
+
+	int calls = 0;
+	const int id = disp->addLoopHook(EventDispatcherLibUv::Idle, countCalls, &calls);
+	QVERIFY(id > 0);
+
+	// Nothing else is pending: without the hook the loop would block until the timer expires
+	for (int n=0; n<3; ++n) {
+		disp->processEvents(QEventLoop::WaitForMoreEvents);
+	}
+
+	QVERIFY(calls >= 3);
+	QVERIFY(timeout.fired.isEmpty());
+
+	QVERIFY(disp->removeLoopHook(id));
+	timeout.killTimer(timer);
+}
+
+LIBUV_TEST_MAIN(tst_LoopHooks)
+
+#include "tst_loophooks.moc"
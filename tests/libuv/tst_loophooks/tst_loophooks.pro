@@ -0,0 +1,4 @@
+TARGET   = tst_loophooks
+SOURCES += tst_loophooks.cpp
+
+include(../libuvtest.pri)
@@ -0,0 +1,105 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtCore/QSocketNotifier>
+#include <QtTest/QtTest>
+#ifdef Q_OS_UNIX
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+#include "libuvtest.h"
+
+/*
+ * Masking only flips a counter: sources keep running, and the activations that arrive meanwhile are replayed
+ * once the mask is lifted. These check the replay: order, one delivery per masked activation, no duplicates.
+ */
+class tst_Masking : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void timersReplayedInExpiryOrder(void);
+	void maskedTimerDeliveredOnce(void);
+	void socketActivationReplayedOnce(void);
+};
+
+void tst_Masking::timersReplayedInExpiryOrder(void)
+{
+	QAbstractEventDispatcher* disp = QAbstractEventDispatcher::instance();
+	TimerRecorder obj;
+
+	const int late  = obj.startTimer(20);
+	const int early = obj.startTimer(10);
+	QTest::qSleep(50);
+
+	disp->processEvents(QEventLoop::X11ExcludeTimers);
+	QVERIFY(obj.fired.isEmpty());
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 2);
+	QCOMPARE(obj.fired.at(0), early);
+	QCOMPARE(obj.fired.at(1), late);
+
+	// Replayed timers are rearmed after delivery
+	LIBUV_TRY_VERIFY(obj.fired.count(early) >= 2 && obj.fired.count(late) >= 2);
+
+	obj.killTimer(early);
+	obj.killTimer(late);
+}
+
+void tst_Masking::maskedTimerDeliveredOnce(void)
+{
+	QAbstractEventDispatcher* disp = QAbstractEventDispatcher::instance();
+	TimerRecorder obj;
+
+	const int id = obj.startTimer(10);
+
+	// A masked timer is not rearmed: however long the mask lasts, it is owed one activation
+	for (int i=0; i<3; ++i) {
+		QTest::qSleep(20);
+		disp->processEvents(QEventLoop::X11ExcludeTimers);
+	}
+
+	QVERIFY(obj.fired.isEmpty());
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(obj.fired.size(), 1);
+	QCOMPARE(obj.fired.at(0), id);
+
+	obj.killTimer(id);
+}
+
+void tst_Masking::socketActivationReplayedOnce(void)
+{
+#ifdef Q_OS_UNIX
+	int fds[2];
+	QCOMPARE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+	QAbstractEventDispatcher* disp = QAbstractEventDispatcher::instance();
+	NotifierRecorder recorder;
+	QSocketNotifier notifier(fds[0], QSocketNotifier::Read);
+	QObject::connect(&notifier, SIGNAL(activated(int)), &recorder, SLOT(activated(int)));
+
+	QCOMPARE(::write(fds[1], "x", 1), static_cast<ssize_t>(1));
+
+	disp->processEvents(QEventLoop::ExcludeSocketNotifiers);
+	QCOMPARE(recorder.fired.size(), 0);
+
+	// The watcher restarted by the unmasking still sees the byte; it must not add a second activation
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(recorder.fired.size(), 1);
+
+	disp->processEvents(QEventLoop::AllEvents);
+	QCOMPARE(recorder.fired.size(), 1);
+
+	QCOMPARE(::write(fds[1], "y", 1), static_cast<ssize_t>(1));
+	LIBUV_TRY_COMPARE(recorder.fired.size(), 2);
+
+	notifier.setEnabled(false);
+	::close(fds[0]);
+	::close(fds[1]);
+#else
+	LIBUV_SKIP("This test requires a Unix system");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_Masking)
+
+#include "tst_masking.moc"
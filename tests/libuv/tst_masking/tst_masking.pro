@@ -0,0 +1,4 @@
+TARGET   = tst_masking
+SOURCES += tst_masking.cpp
+
+include(../libuvtest.pri)
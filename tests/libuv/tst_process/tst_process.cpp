@@ -0,0 +1,93 @@
+#include <QtCore/QByteArray>
+#include <QtCore/QStringList>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+#include <uv.h>
+#include "process_libuv.h"
+#include "libuvtest.h"
+
+class tst_Process : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void outputAndExitCode(void);
+	void closeWriteChannelAfterQueuedData(void);
+};
+
+void tst_Process::outputAndExitCode(void)
+{
+#if UV_VERSION_MAJOR >= 1 && defined(Q_OS_UNIX)
+	ProcessLibUv process;
+	QSignalSpy started(&process, SIGNAL(started()));
+	QSignalSpy finished(&process, SIGNAL(finished(qint64,int)));
+
+	QStringList args;
+	args << QLatin1String("-c") << QLatin1String("printf out; printf err >&2; exit 3");
+	QVERIFY(process.start(QLatin1String("/bin/sh"), args));
+	QCOMPARE(process.state(), ProcessLibUv::Running);
+	QVERIFY(process.pid() > 0);
+
+	LIBUV_TRY_COMPARE(finished.count(), 1);
+	QCOMPARE(started.count(), 1);
+	QCOMPARE(finished.at(0).at(0).toLongLong(), Q_INT64_C(3));
+	QCOMPARE(finished.at(0).at(1).toInt(), 0);
+	QCOMPARE(process.state(), ProcessLibUv::NotRunning);
+	QCOMPARE(process.exitCode(), Q_INT64_C(3));
+
+	// Both channels have reached end of file by the time finished() is emitted
+	QCOMPARE(process.readAllStandardOutput(), QByteArray("out"));
+	QCOMPARE(process.readAllStandardError(), QByteArray("err"));
+#else
+	LIBUV_SKIP("ProcessLibUv requires libuv 1.0+ and a Unix system here");
+#endif
+}
+
+void tst_Process::closeWriteChannelAfterQueuedData(void)
+{
+#if UV_VERSION_MAJOR >= 1 && defined(Q_OS_UNIX)
+	ProcessLibUv process;
+	QSignalSpy finished(&process, SIGNAL(finished(qint64,int)));
+	QSignalSpy written(&process, SIGNAL(bytesWritten(qint64)));
+
+	QVERIFY(process.start(QLatin1String("cat")));
+
+	// More than a pipe holds: the writes are still queued when the channel is closed
+	QByteArray data(1024 * 1024, Qt::Uninitialized);
+	for (int i=0; i<data.size(); ++i) {
+		data[i] = static_cast<char>('a' + i % 26);
+	}
+
+	QCOMPARE(process.write(data.left(16)), Q_INT64_C(16));
+	QCOMPARE(process.write(data.mid(16)), static_cast<qint64>(data.size() - 16));
+	process.closeWriteChannel();
+
+	QTest::ignoreMessage(QtWarningMsg, "ProcessLibUv::write: the write channel is closed");
+	QCOMPARE(process.write(QByteArray("late")), Q_INT64_C(-1));
+
+	// cat only exits on end of file, which comes after all the data
+	QByteArray output;
+	for (int i=0; i<1000 && !finished.count(); ++i) {
+		QTest::qWait(10);
+		output.append(process.readAllStandardOutput());
+	}
+
+	QCOMPARE(finished.count(), 1);
+	QCOMPARE(finished.at(0).at(0).toLongLong(), Q_INT64_C(0));
+	output.append(process.readAllStandardOutput());
+	QCOMPARE(output.size(), data.size());
+	QVERIFY(output == data);
+
+	qint64 total = 0;
+	for (int i=0; i<written.count(); ++i) {
+		total += written.at(i).at(0).toLongLong();
+	}
+
+	QCOMPARE(total, static_cast<qint64>(data.size()));
+	QCOMPARE(process.bytesToWrite(), Q_INT64_C(0));
+#else
+	LIBUV_SKIP("ProcessLibUv requires libuv 1.0+ and a Unix system here");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_Process)
+
+#include "tst_process.moc"
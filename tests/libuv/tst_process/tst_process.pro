@@ -0,0 +1,4 @@
+TARGET   = tst_process
+SOURCES += tst_process.cpp
+
+include(../libuvtest.pri)
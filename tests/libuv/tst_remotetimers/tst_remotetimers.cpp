@@ -0,0 +1,195 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#include "libuvtest.h"
+
+namespace {
+
+	// Not allocated by Qt for a long time: Qt hands out timer ids from 1 upwards
+	static const int REMOTE_TIMER_ID = 0x10000;
+
+#if QT_VERSION >= 0x040400
+	// Runs a function on a thread of its own and waits for it, so that the dispatcher sees a foreign thread
+	class RemoteThread : public QThread {
+	public:
+		typedef void (*Function)(EventDispatcherLibUv* disp, QObject* object);
+
+		RemoteThread(Function f, EventDispatcherLibUv* disp, QObject* object)
+			: QThread(), m_f(f), m_disp(disp), m_object(object)
+		{
+		}
+
+		static void call(Function f, EventDispatcherLibUv* disp, QObject* object)
+		{
+			RemoteThread thread(f, disp, object);
+			thread.start();
+			thread.wait();
+		}
+
+	protected:
+		virtual void run(void) { this->m_f(this->m_disp, this->m_object); }
+
+	private:
+		Function m_f;
+		EventDispatcherLibUv* m_disp;
+		QObject* m_object;
+	};
+
+	class RecordTask : public EventDispatcherLibUv::Task {
+	public:
+		RecordTask(QList<int>* list, int value) : EventDispatcherLibUv::Task(), m_list(list), m_value(value) {}
+		virtual void run(void) { this->m_list->append(this->m_value); }
+
+	private:
+		QList<int>* m_list;
+		int m_value;
+	};
+
+	static void registerTimer(EventDispatcherLibUv* disp, int id, int interval, QObject* object)
+	{
+#if QT_VERSION >= 0x050000
+		disp->registerTimer(id, interval, Qt::PreciseTimer, object);
+#else
+		disp->registerTimer(id, interval, object);
+#endif
+	}
+
+	static QList<int>* g_tasks = 0;
+
+	static void postTasks(EventDispatcherLibUv* disp, QObject*)
+	{
+		for (int i=0; i<100; ++i) {
+			disp->postTask(new RecordTask(g_tasks, i));
+		}
+	}
+
+	static void registerRemoteTimer(EventDispatcherLibUv* disp, QObject* object)
+	{
+		registerTimer(disp, REMOTE_TIMER_ID, 10, object);
+	}
+
+	static void unregisterRemoteTimer(EventDispatcherLibUv* disp, QObject*)
+	{
+		disp->unregisterTimer(REMOTE_TIMER_ID);
+	}
+
+	static void registerAndUnregisterTimers(EventDispatcherLibUv* disp, QObject* object)
+	{
+		registerTimer(disp, REMOTE_TIMER_ID, 10, object);
+		registerTimer(disp, REMOTE_TIMER_ID + 1, 10, object);
+		registerTimer(disp, REMOTE_TIMER_ID + 2, 0, object);
+		disp->unregisterTimers(object);
+	}
+#endif
+
+}
+
+/*
+ * Timers registered and unregistered from other threads travel through the dispatcher's task queue; the commands
+ * must run in the order they were issued and must not touch registrations made after them.
+ */
+class tst_RemoteTimers : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void tasksRunInOrder(void);
+	void remoteRegistration(void);
+	void remoteUnregisterTimers(void);
+	void queuedUnregisterSparesReusedId(void);
+};
+
+void tst_RemoteTimers::tasksRunInOrder(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	QList<int> list;
+	g_tasks = &list;
+	RemoteThread::call(postTasks, disp, 0);
+	QVERIFY(list.isEmpty());
+
+	LIBUV_TRY_COMPARE(list.size(), 100);
+	for (int i=0; i<list.size(); ++i) {
+		QCOMPARE(list.at(i), i);
+	}
+
+	g_tasks = 0;
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_RemoteTimers::remoteRegistration(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder obj;
+	RemoteThread::call(registerRemoteTimer, disp, &obj);
+
+	// Nothing happens until the dispatcher's thread runs the command
+	QVERIFY(disp->registeredTimers(&obj).isEmpty());
+
+	LIBUV_TRY_VERIFY(obj.fired.size() >= 3);
+	QCOMPARE(obj.fired.count(REMOTE_TIMER_ID), obj.fired.size());
+	QCOMPARE(disp->registeredTimers(&obj).size(), 1);
+	QCOMPARE(LIBUV_TIMER_ID(disp->registeredTimers(&obj).at(0)), REMOTE_TIMER_ID);
+
+	RemoteThread::call(unregisterRemoteTimer, disp, &obj);
+	LIBUV_TRY_VERIFY(disp->registeredTimers(&obj).isEmpty());
+
+	const int count = obj.fired.size();
+	QTest::qWait(50);
+	QCOMPARE(obj.fired.size(), count);
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_RemoteTimers::remoteUnregisterTimers(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	// The registrations precede the unregistration in the queue: none of the timers ever fires
+	TimerRecorder obj;
+	RemoteThread::call(registerAndUnregisterTimers, disp, &obj);
+
+	QTest::qWait(50);
+	QVERIFY(obj.fired.isEmpty());
+	QVERIFY(disp->registeredTimers(&obj).isEmpty());
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_RemoteTimers::queuedUnregisterSparesReusedId(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder obj;
+	registerTimer(disp, REMOTE_TIMER_ID, 10, &obj);
+
+	// The queued command returns at once; the id is then free and is taken again before the command runs
+	RemoteThread::call(unregisterRemoteTimer, disp, &obj);
+	QVERIFY(disp->unregisterTimer(REMOTE_TIMER_ID));
+	registerTimer(disp, REMOTE_TIMER_ID, 10, &obj);
+
+	LIBUV_TRY_VERIFY(obj.fired.size() >= 3);
+	QCOMPARE(disp->registeredTimers(&obj).size(), 1);
+
+	QVERIFY(disp->unregisterTimer(REMOTE_TIMER_ID));
+	QVERIFY(disp->registeredTimers(&obj).isEmpty());
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_RemoteTimers)
+
+#include "tst_remotetimers.moc"
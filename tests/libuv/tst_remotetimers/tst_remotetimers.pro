@@ -0,0 +1,4 @@
+TARGET   = tst_remotetimers
+SOURCES += tst_remotetimers.cpp
+
+include(../libuvtest.pri)
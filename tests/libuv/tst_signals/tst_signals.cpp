@@ -0,0 +1,120 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+#ifdef Q_OS_UNIX
+#	include <signal.h>
+#endif
+#include "libuvtest.h"
+
+/*
+ * Signals received during one loop iteration are reported by a single unixSignal() emission with their count.
+ * raise() runs libuv's handler synchronously: whatever is raised before the loop runs is seen by one iteration.
+ */
+class tst_Signals : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void coalescedWithinIteration(void);
+	void statisticsStartAtWatch(void);
+	void unwatchDropsPending(void);
+};
+
+void tst_Signals::coalescedWithinIteration(void)
+{
+#ifdef Q_OS_UNIX
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	QSignalSpy spy(disp, SIGNAL(unixSignal(int,int)));
+	QVERIFY(disp->watchUnixSignal(SIGUSR1));
+	QVERIFY(disp->isUnixSignalWatched(SIGUSR1));
+
+	::raise(SIGUSR1);
+	::raise(SIGUSR1);
+
+	LIBUV_TRY_COMPARE(spy.count(), 1);
+	QCOMPARE(spy.at(0).at(0).toInt(), int(SIGUSR1));
+	QCOMPARE(spy.at(0).at(1).toInt(), 2);
+
+	EventDispatcherLibUv::SignalStatistics stats = disp->unixSignalStatistics(SIGUSR1);
+	QCOMPARE(stats.received, Q_UINT64_C(2));
+	QCOMPARE(stats.emitted, Q_UINT64_C(1));
+
+	// The next iteration starts a new count
+	::raise(SIGUSR1);
+	LIBUV_TRY_COMPARE(spy.count(), 2);
+	QCOMPARE(spy.at(1).at(1).toInt(), 1);
+
+	stats = disp->unixSignalStatistics(SIGUSR1);
+	QCOMPARE(stats.received, Q_UINT64_C(3));
+	QCOMPARE(stats.emitted, Q_UINT64_C(2));
+
+	disp->unwatchUnixSignal(SIGUSR1);
+	QVERIFY(!disp->isUnixSignalWatched(SIGUSR1));
+#else
+	LIBUV_SKIP("This test requires a Unix system");
+#endif
+}
+
+void tst_Signals::statisticsStartAtWatch(void)
+{
+#ifdef Q_OS_UNIX
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	// Unwatched signals have no counters; the previous test's ones went with unwatchUnixSignal()
+	EventDispatcherLibUv::SignalStatistics stats = disp->unixSignalStatistics(SIGUSR1);
+	QCOMPARE(stats.received, Q_UINT64_C(0));
+	QCOMPARE(stats.emitted, Q_UINT64_C(0));
+
+	QSignalSpy spy(disp, SIGNAL(unixSignal(int,int)));
+	QVERIFY(disp->watchUnixSignal(SIGUSR1));
+	::raise(SIGUSR1);
+	LIBUV_TRY_COMPARE(spy.count(), 1);
+
+	// Watching a watched signal again keeps the counters
+	QVERIFY(disp->watchUnixSignal(SIGUSR1));
+	stats = disp->unixSignalStatistics(SIGUSR1);
+	QCOMPARE(stats.received, Q_UINT64_C(1));
+	QCOMPARE(stats.emitted, Q_UINT64_C(1));
+
+	disp->unwatchUnixSignal(SIGUSR1);
+	stats = disp->unixSignalStatistics(SIGUSR1);
+	QCOMPARE(stats.received, Q_UINT64_C(0));
+	QCOMPARE(stats.emitted, Q_UINT64_C(0));
+#else
+	LIBUV_SKIP("This test requires a Unix system");
+#endif
+}
+
+void tst_Signals::unwatchDropsPending(void)
+{
+#ifdef Q_OS_UNIX
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	QSignalSpy spy(disp, SIGNAL(unixSignal(int,int)));
+	QVERIFY(disp->watchUnixSignal(SIGUSR2));
+	::raise(SIGUSR2);
+
+	// Received by libuv, not emitted yet
+	disp->unwatchUnixSignal(SIGUSR2);
+	QVERIFY(!disp->isUnixSignalWatched(SIGUSR2));
+
+	QTest::qWait(50);
+	QCOMPARE(spy.count(), 0);
+
+	// The other watched signals are not affected
+	QVERIFY(disp->watchUnixSignal(SIGUSR1));
+	::raise(SIGUSR1);
+	LIBUV_TRY_COMPARE(spy.count(), 1);
+	QCOMPARE(spy.at(0).at(0).toInt(), int(SIGUSR1));
+	QCOMPARE(spy.at(0).at(1).toInt(), 1);
+	disp->unwatchUnixSignal(SIGUSR1);
+#else
+	LIBUV_SKIP("This test requires a Unix system");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_Signals)
+
+#include "tst_signals.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_signals
+SOURCES += tst_signals.cpp
+
+include(../libuvtest.pri)
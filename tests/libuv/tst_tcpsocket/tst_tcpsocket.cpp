@@ -0,0 +1,181 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QByteArray>
+#include <QtCore/QThread>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+#include <uv.h>
+#include "tcpsocket_libuv.h"
+#include "libuvtest.h"
+
+#if UV_VERSION_MAJOR >= 1
+namespace {
+
+	qint64 sum(const QSignalSpy& spy)
+	{
+		qint64 res = 0;
+		for (int i=0; i<spy.count(); ++i) {
+			res += spy.at(i).at(0).toLongLong();
+		}
+
+		return res;
+	}
+
+#if QT_VERSION >= 0x050000
+	// Leaves a socket with unread data behind when the thread, and its dispatcher with it, goes away
+	class OrphanThread : public QThread {
+	public:
+		OrphanThread(void) : QThread(), socket(0) { this->setEventDispatcher(new EventDispatcherLibUv()); }
+
+		TcpSocketLibUv* socket;
+
+	protected:
+		virtual void run(void)
+		{
+			TcpServerLibUv server;
+			if (!server.listen(QLatin1String("127.0.0.1"))) {
+				return;
+			}
+
+			QAbstractEventDispatcher* disp = QAbstractEventDispatcher::instance();
+			TcpSocketLibUv* client         = new TcpSocketLibUv;
+			TcpSocketLibUv* peer           = 0;
+			client->connectToHost(QLatin1String("127.0.0.1"), server.serverPort());
+
+			for (int i=0; i<500 && client->bytesAvailable() < 4; ++i) {
+				QThread::msleep(10);
+				disp->processEvents(QEventLoop::AllEvents);
+				if (!peer && server.hasPendingConnections()) {
+					peer = server.nextPendingConnection();
+					peer->write(QByteArray("data"));
+				}
+			}
+
+			this->socket = client;
+		}
+	};
+#endif
+
+}
+#endif
+
+class tst_TcpSocket : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void echo(void);
+	void partialTryWrite(void);
+	void outlivesDispatcher(void);
+};
+
+void tst_TcpSocket::echo(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	TcpServerLibUv server;
+	QVERIFY(server.listen(QLatin1String("127.0.0.1")));
+	QVERIFY(server.serverPort() != 0);
+
+	TcpSocketLibUv client;
+	QSignalSpy connected(&client, SIGNAL(connected()));
+	QSignalSpy written(&client, SIGNAL(bytesWritten(qint64)));
+	client.connectToHost(QLatin1String("127.0.0.1"), server.serverPort());
+	QCOMPARE(client.state(), TcpSocketLibUv::ConnectingState);
+
+	// Written before the connection is up: queued and sent once it is
+	QCOMPARE(client.write(QByteArray("ping ")), Q_INT64_C(5));
+	LIBUV_TRY_COMPARE(connected.count(), 1);
+	QCOMPARE(client.state(), TcpSocketLibUv::ConnectedState);
+
+	LIBUV_TRY_VERIFY(server.hasPendingConnections());
+	TcpSocketLibUv* peer = server.nextPendingConnection();
+	QVERIFY(peer != 0);
+	QCOMPARE(client.peerPort(), server.serverPort());
+	QCOMPARE(peer->peerPort(), client.localPort());
+
+	QList<QByteArray> parts;
+	parts << QByteArray("pong ") << QByteArray() << QByteArray("done");
+	QCOMPARE(client.write(parts), Q_INT64_C(9));
+
+	const QByteArray expected("ping pong done");
+	QByteArray echoed;
+	QByteArray received;
+	for (int i=0; i<500 && received.size() < expected.size(); ++i) {
+		QTest::qWait(10);
+
+		QByteArray data = peer->readAll();
+		echoed.append(data);
+		peer->write(data);
+		received.append(client.readAll());
+	}
+
+	QCOMPARE(echoed, expected);
+	QCOMPARE(received, expected);
+	LIBUV_TRY_COMPARE(sum(written), static_cast<qint64>(expected.size()));
+
+	QSignalSpy disconnected(&client, SIGNAL(disconnected()));
+	peer->disconnectFromHost();
+	LIBUV_TRY_COMPARE(disconnected.count(), 1);
+	QCOMPARE(client.state(), TcpSocketLibUv::UnconnectedState);
+#else
+	LIBUV_SKIP("TcpSocketLibUv requires libuv 1.0+");
+#endif
+}
+
+void tst_TcpSocket::partialTryWrite(void)
+{
+#if UV_VERSION_MAJOR >= 1
+	TcpServerLibUv server;
+	QVERIFY(server.listen(QLatin1String("127.0.0.1")));
+
+	TcpSocketLibUv client;
+	QSignalSpy connected(&client, SIGNAL(connected()));
+	QSignalSpy written(&client, SIGNAL(bytesWritten(qint64)));
+	client.connectToHost(QLatin1String("127.0.0.1"), server.serverPort());
+	LIBUV_TRY_COMPARE(connected.count(), 1);
+	LIBUV_TRY_VERIFY(server.hasPendingConnections());
+	TcpSocketLibUv* peer = server.nextPendingConnection();
+
+	// Far more than the socket buffers take: uv_try_write() sends a part, the rest goes through uv_write()
+	QByteArray data(32 * 1024 * 1024, Qt::Uninitialized);
+	for (int i=0; i<data.size(); ++i) {
+		data[i] = static_cast<char>(i % 251);
+	}
+
+	QCOMPARE(client.write(data), static_cast<qint64>(data.size()));
+	QVERIFY(client.bytesToWrite() > 0);
+	QVERIFY(client.bytesToWrite() < static_cast<qint64>(data.size()));
+
+	QByteArray received;
+	for (int i=0; i<3000 && received.size() < data.size(); ++i) {
+		QTest::qWait(10);
+		received.append(peer->readAll());
+	}
+
+	QCOMPARE(received.size(), data.size());
+	QVERIFY(received == data);
+	LIBUV_TRY_COMPARE(sum(written), static_cast<qint64>(data.size()));
+	QCOMPARE(client.bytesToWrite(), Q_INT64_C(0));
+#else
+	LIBUV_SKIP("TcpSocketLibUv requires libuv 1.0+");
+#endif
+}
+
+void tst_TcpSocket::outlivesDispatcher(void)
+{
+#if UV_VERSION_MAJOR >= 1 && QT_VERSION >= 0x050000
+	OrphanThread thread;
+	thread.start();
+	QVERIFY(thread.wait());
+
+	// The handle went with the loop; the data received before is still there
+	TcpSocketLibUv* socket = thread.socket;
+	QVERIFY(socket != 0);
+	QCOMPARE(socket->state(), TcpSocketLibUv::UnconnectedState);
+	QCOMPARE(socket->readAll(), QByteArray("data"));
+	delete socket;
+#else
+	LIBUV_SKIP("This test requires Qt 5 and libuv 1.0+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_TcpSocket)
+
+#include "tst_tcpsocket.moc"
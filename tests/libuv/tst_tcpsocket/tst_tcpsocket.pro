@@ -0,0 +1,4 @@
+TARGET   = tst_tcpsocket
+SOURCES += tst_tcpsocket.cpp
+
+include(../libuvtest.pri)
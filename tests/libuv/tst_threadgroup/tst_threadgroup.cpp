@@ -0,0 +1,136 @@
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#include <uv.h>
+#include "tcpsocket_libuv.h"
+#include "threadgroup_libuv.h"
+#include "libuvtest.h"
+
+#if QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1 && defined(Q_OS_UNIX)
+namespace {
+
+	static const int THREADS     = 2;
+	static const int CONNECTIONS = 8;
+
+	struct Deliveries {
+		QThread* threads[THREADS];
+		QAtomicInt counts[THREADS];
+		QAtomicInt wrongThread;
+	};
+
+	void countConnection(TcpSocketLibUv* socket, int thread, void* data)
+	{
+		Deliveries* d = static_cast<Deliveries*>(data);
+		if (QThread::currentThread() != d->threads[thread]) {
+			d->wrongThread.ref();
+		}
+
+		d->counts[thread].ref();
+		delete socket;
+	}
+
+	int total(const Deliveries& d)
+	{
+		int res = 0;
+		for (int i=0; i<THREADS; ++i) {
+			res += d.counts[i].load();
+		}
+
+		return res;
+	}
+
+	// Starts the group, connects CONNECTIONS clients from this thread and waits until the handler has seen them all
+	bool run(ThreadGroupLibUv::Distribution mode, Deliveries& d, ThreadGroupLibUv& group)
+	{
+		if (!group.start(THREADS)) {
+			return false;
+		}
+
+		for (int i=0; i<THREADS; ++i) {
+			d.threads[i] = group.workerThread(i);
+		}
+
+		if (!group.listen(QLatin1String("127.0.0.1"), 0, countConnection, &d, mode) || !group.serverPort()) {
+			return false;
+		}
+
+		QList<TcpSocketLibUv*> clients;
+		for (int i=0; i<CONNECTIONS; ++i) {
+			TcpSocketLibUv* client = new TcpSocketLibUv;
+			client->connectToHost(QLatin1String("127.0.0.1"), group.serverPort());
+			clients.append(client);
+		}
+
+		for (int i=0; i<500 && total(d) < CONNECTIONS; ++i) {
+			QTest::qWait(10);
+		}
+
+		qDeleteAll(clients);
+		return true;
+	}
+
+}
+#endif
+
+/*
+ * Every connection reaches the handler exactly once, on the thread it was assigned to; the per-thread load
+ * statistics agree with what the handler saw.
+ */
+class tst_ThreadGroup : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void acceptHandoffRoundRobin(void);
+	void reusePortDeliversAll(void);
+};
+
+void tst_ThreadGroup::acceptHandoffRoundRobin(void)
+{
+#if QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1 && defined(Q_OS_UNIX)
+	Deliveries d;
+	ThreadGroupLibUv group;
+	QVERIFY(run(ThreadGroupLibUv::AcceptHandoff, d, group));
+	QCOMPARE(total(d), CONNECTIONS);
+	QCOMPARE(d.wrongThread.load(), 0);
+
+	// Handed out in turn: every thread gets the same share
+	for (int i=0; i<THREADS; ++i) {
+		QCOMPARE(d.counts[i].load(), CONNECTIONS / THREADS);
+		QCOMPARE(group.threadLoad(i).connections, static_cast<quint64>(CONNECTIONS / THREADS));
+	}
+
+	group.stop();
+	QVERIFY(!group.isRunning());
+#else
+	LIBUV_SKIP("ThreadGroupLibUv requires Qt 5, libuv 1.0+ and a Unix system");
+#endif
+}
+
+void tst_ThreadGroup::reusePortDeliversAll(void)
+{
+#if QT_VERSION >= 0x050000 && UV_VERSION_MAJOR >= 1 && defined(Q_OS_UNIX)
+	Deliveries d;
+	ThreadGroupLibUv group;
+	if (!run(ThreadGroupLibUv::ReusePort, d, group) && group.error() == UV_ENOTSUP) {
+		LIBUV_SKIP("SO_REUSEPORT is not available");
+	}
+
+	QVERIFY(group.isListening());
+	QCOMPARE(total(d), CONNECTIONS);
+	QCOMPARE(d.wrongThread.load(), 0);
+
+	// The kernel picks the thread: only the sum is known
+	for (int i=0; i<THREADS; ++i) {
+		QCOMPARE(group.threadLoad(i).connections, static_cast<quint64>(d.counts[i].load()));
+	}
+
+	group.stop();
+	QVERIFY(!group.isRunning());
+#else
+	LIBUV_SKIP("ThreadGroupLibUv requires Qt 5, libuv 1.0+ and a Unix system");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_ThreadGroup)
+
+#include "tst_threadgroup.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_threadgroup
+SOURCES += tst_threadgroup.cpp
+
+include(../libuvtest.pri)
@@ -0,0 +1,208 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+#if QT_VERSION >= 0x040400
+#	include <QtCore/QFuture>
+#	include <QtCore/QSemaphore>
+#endif
+#include "libuvtest.h"
+
+#if QT_VERSION >= 0x040400
+namespace {
+
+	struct Record {
+		QList<int> executed;
+		QList<int> finished;
+		QList<QThread*> threads;
+	};
+
+	class RecordWork : public EventDispatcherLibUv::Work {
+	public:
+		RecordWork(Record* record, int value) : EventDispatcherLibUv::Work(), m_record(record), m_value(value), m_thread(0) {}
+
+		virtual void execute(void)
+		{
+			// Only this work item touches the list while the pool runs it: the items run one at a time
+			this->m_thread = QThread::currentThread();
+			this->m_record->executed.append(this->m_value);
+		}
+
+		virtual void finish(void)
+		{
+			this->m_record->finished.append(this->m_value);
+			this->m_record->threads.append(this->m_thread);
+		}
+
+	private:
+		Record* m_record;
+		int m_value;
+		QThread* m_thread;
+	};
+
+	// Occupies a pool thread until released
+	class BlockingWork : public EventDispatcherLibUv::Work {
+	public:
+		explicit BlockingWork(QSemaphore* sem) : EventDispatcherLibUv::Work(), m_sem(sem) {}
+		virtual void execute(void) { this->m_sem->acquire(); }
+		virtual void finish(void) {}
+
+	private:
+		QSemaphore* m_sem;
+	};
+
+	class QueueThread : public QThread {
+	public:
+		QueueThread(EventDispatcherLibUv* disp, Record* record) : QThread(), m_disp(disp), m_record(record) {}
+
+	protected:
+		virtual void run(void)
+		{
+			for (int i=0; i<10; ++i) {
+				this->m_disp->queueWork(new RecordWork(this->m_record, i));
+			}
+		}
+
+	private:
+		EventDispatcherLibUv* m_disp;
+		Record* m_record;
+	};
+
+	static QAtomicInt g_calls(0);
+
+	int answer(void)
+	{
+		g_calls.ref();
+		return 42;
+	}
+
+}
+#endif
+
+/*
+ * The pool is limited to one thread before anything uses it, which makes the execution order deterministic;
+ * setThreadPoolSize() must run first.
+ */
+class tst_ThreadPool : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void setThreadPoolSize(void);
+	void queueWork(void);
+	void queueWorkFromOtherThread(void);
+	void runInThreadPool(void);
+	void cancelBeforeExecution(void);
+};
+
+void tst_ThreadPool::setThreadPoolSize(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	QVERIFY(!EventDispatcherLibUv::setThreadPoolSize(0));
+	QVERIFY(EventDispatcherLibUv::setThreadPoolSize(2));
+	QVERIFY(EventDispatcherLibUv::setThreadPoolSize(1));
+	QCOMPARE(qgetenv("UV_THREADPOOL_SIZE"), QByteArray("1"));
+
+	// The pool may have started from here on
+	Record record;
+	disp->queueWork(new RecordWork(&record, 0));
+	QVERIFY(!EventDispatcherLibUv::setThreadPoolSize(4));
+	QCOMPARE(qgetenv("UV_THREADPOOL_SIZE"), QByteArray("1"));
+
+	LIBUV_TRY_COMPARE(record.finished.size(), 1);
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_ThreadPool::queueWork(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	Record record;
+	for (int i=0; i<10; ++i) {
+		disp->queueWork(new RecordWork(&record, i));
+	}
+
+	// Completions are only delivered by the event loop
+	QVERIFY(record.finished.isEmpty());
+
+	LIBUV_TRY_COMPARE(record.finished.size(), 10);
+	for (int i=0; i<10; ++i) {
+		QCOMPARE(record.executed.at(i), i);
+		QCOMPARE(record.finished.at(i), i);
+		QVERIFY(record.threads.at(i) != 0);
+		QVERIFY(record.threads.at(i) != QThread::currentThread());
+	}
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_ThreadPool::queueWorkFromOtherThread(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	Record record;
+	QueueThread thread(disp, &record);
+	thread.start();
+	QVERIFY(thread.wait());
+
+	// The requests travel through the task queue and keep their order
+	LIBUV_TRY_COMPARE(record.finished.size(), 10);
+	for (int i=0; i<10; ++i) {
+		QCOMPARE(record.finished.at(i), i);
+	}
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_ThreadPool::runInThreadPool(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	g_calls.fetchAndStoreRelaxed(0);
+	QFuture<int> future = disp->runInThreadPool<int>(answer);
+	LIBUV_TRY_VERIFY(future.isFinished());
+	QVERIFY(!future.isCanceled());
+	QCOMPARE(future.result(), 42);
+	QCOMPARE(g_calls.fetchAndAddRelaxed(0), 1);
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+void tst_ThreadPool::cancelBeforeExecution(void)
+{
+#if QT_VERSION >= 0x040400
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	// The only pool thread is busy: the function cannot start before the future is cancelled
+	QSemaphore sem;
+	disp->queueWork(new BlockingWork(&sem));
+
+	g_calls.fetchAndStoreRelaxed(0);
+	QFuture<int> future = disp->runInThreadPool<int>(answer);
+	future.cancel();
+	sem.release();
+
+	LIBUV_TRY_VERIFY(future.isFinished());
+	QVERIFY(future.isCanceled());
+	QCOMPARE(g_calls.fetchAndAddRelaxed(0), 0);
+#else
+	LIBUV_SKIP("This test requires Qt 4.4+");
+#endif
+}
+
+LIBUV_TEST_MAIN(tst_ThreadPool)
+
+#include "tst_threadpool.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_threadpool
+SOURCES += tst_threadpool.cpp
+
+include(../libuvtest.pri)
@@ -0,0 +1,157 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtTest/QtTest>
+#include "libuvtest.h"
+
+namespace {
+
+	// Not allocated by Qt for a long time: Qt hands out timer ids from 1 upwards
+	static const int TIMER_ID = 0x20000;
+
+	static void registerTimer(EventDispatcherLibUv* disp, int id, int interval, QObject* object)
+	{
+#if QT_VERSION >= 0x050000
+		disp->registerTimer(id, interval, Qt::PreciseTimer, object);
+#else
+		disp->registerTimer(id, interval, object);
+#endif
+	}
+
+	static QList<int> timerIds(const QList<QAbstractEventDispatcher::TimerInfo>& list)
+	{
+		QList<int> res;
+		for (int i=0; i<list.size(); ++i) {
+			res.append(LIBUV_TIMER_ID(list.at(i)));
+		}
+
+		return res;
+	}
+
+}
+
+/*
+ * registeredTimers() and unregisterTimers() only visit the object's own timers, regular and zero ones; the index
+ * must follow every registration and unregistration.
+ */
+class tst_TimerIndex : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void registeredTimersPerObject(void);
+	void unregisterSingleTimer(void);
+	void unregisterTimersSparesOtherObjects(void);
+};
+
+void tst_TimerIndex::registeredTimersPerObject(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder a;
+	TimerRecorder b;
+	TimerRecorder c;
+	registerTimer(disp, TIMER_ID,     10, &a);
+	registerTimer(disp, TIMER_ID + 1,  0, &a);
+	registerTimer(disp, TIMER_ID + 2, 20, &a);
+	registerTimer(disp, TIMER_ID + 3, 10, &b);
+	registerTimer(disp, TIMER_ID + 4,  0, &b);
+
+	QList<int> ids = timerIds(disp->registeredTimers(&a));
+	QCOMPARE(ids.size(), 3);
+	QVERIFY(ids.contains(TIMER_ID));
+	QVERIFY(ids.contains(TIMER_ID + 1));
+	QVERIFY(ids.contains(TIMER_ID + 2));
+
+	ids = timerIds(disp->registeredTimers(&b));
+	QCOMPARE(ids.size(), 2);
+	QVERIFY(ids.contains(TIMER_ID + 3));
+	QVERIFY(ids.contains(TIMER_ID + 4));
+
+	QVERIFY(disp->registeredTimers(&c).isEmpty());
+
+	// Zero timers are reported with a zero interval
+	QList<QAbstractEventDispatcher::TimerInfo> list = disp->registeredTimers(&b);
+	for (int i=0; i<list.size(); ++i) {
+#if QT_VERSION >= 0x050000
+		QCOMPARE(list.at(i).interval, (list.at(i).timerId == TIMER_ID + 4) ? 0 : 10);
+#else
+		QCOMPARE(list.at(i).second, (list.at(i).first == TIMER_ID + 4) ? 0 : 10);
+#endif
+	}
+
+	QVERIFY(disp->unregisterTimers(&a));
+	QVERIFY(disp->unregisterTimers(&b));
+	QVERIFY(!disp->unregisterTimers(&c));
+}
+
+void tst_TimerIndex::unregisterSingleTimer(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder a;
+	registerTimer(disp, TIMER_ID,     10, &a);
+	registerTimer(disp, TIMER_ID + 1,  0, &a);
+	registerTimer(disp, TIMER_ID + 2, 20, &a);
+
+	// Removed from the middle of both lists
+	QVERIFY(disp->unregisterTimer(TIMER_ID + 1));
+	QVERIFY(!disp->unregisterTimer(TIMER_ID + 1));
+	QList<int> ids = timerIds(disp->registeredTimers(&a));
+	QCOMPARE(ids.size(), 2);
+	QVERIFY(ids.contains(TIMER_ID));
+	QVERIFY(ids.contains(TIMER_ID + 2));
+
+	QVERIFY(disp->unregisterTimer(TIMER_ID));
+	ids = timerIds(disp->registeredTimers(&a));
+	QCOMPARE(ids.size(), 1);
+	QCOMPARE(ids.at(0), TIMER_ID + 2);
+
+	// The last timer takes the object's entry with it
+	QVERIFY(disp->unregisterTimer(TIMER_ID + 2));
+	QVERIFY(disp->registeredTimers(&a).isEmpty());
+	QVERIFY(!disp->unregisterTimers(&a));
+
+	// and a new registration starts a new one
+	registerTimer(disp, TIMER_ID, 0, &a);
+	ids = timerIds(disp->registeredTimers(&a));
+	QCOMPARE(ids.size(), 1);
+	QCOMPARE(ids.at(0), TIMER_ID);
+	QVERIFY(disp->unregisterTimers(&a));
+	QVERIFY(disp->registeredTimers(&a).isEmpty());
+}
+
+void tst_TimerIndex::unregisterTimersSparesOtherObjects(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder a;
+	TimerRecorder b;
+	registerTimer(disp, TIMER_ID,     10, &a);
+	registerTimer(disp, TIMER_ID + 1,  0, &a);
+	registerTimer(disp, TIMER_ID + 2, 10, &b);
+	registerTimer(disp, TIMER_ID + 3,  0, &b);
+
+	QVERIFY(disp->unregisterTimers(&a));
+	QVERIFY(disp->registeredTimers(&a).isEmpty());
+	QCOMPARE(disp->registeredTimers(&b).size(), 2);
+
+	// a's ids are free again and unknown to the dispatcher
+	QVERIFY(!disp->unregisterTimer(TIMER_ID));
+	QVERIFY(!disp->unregisterTimer(TIMER_ID + 1));
+
+	LIBUV_TRY_VERIFY(b.fired.count(TIMER_ID + 2) >= 2);
+	QVERIFY(b.fired.count(TIMER_ID + 3) >= 2);
+	QCOMPARE(b.fired.count(TIMER_ID + 2) + b.fired.count(TIMER_ID + 3), b.fired.size());
+	QVERIFY(a.fired.isEmpty());
+
+	QVERIFY(disp->unregisterTimers(&b));
+	const int count = b.fired.size();
+	QTest::qWait(30);
+	QCOMPARE(b.fired.size(), count);
+	QVERIFY(disp->registeredTimers(&b).isEmpty());
+}
+
+LIBUV_TEST_MAIN(tst_TimerIndex)
+
+#include "tst_timerindex.moc"
@@ -0,0 +1,4 @@
+TARGET   = tst_timerindex
+SOURCES += tst_timerindex.cpp
+
+include(../libuvtest.pri)
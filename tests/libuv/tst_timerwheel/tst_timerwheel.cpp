@@ -0,0 +1,186 @@
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QList>
+#include <QtTest/QtTest>
+#include "libuvtest.h"
+
+namespace {
+
+	// The first of the two timers to fire kills the other one
+	class TimerKiller : public QObject {
+	public:
+		TimerKiller(void) : QObject(), first(0), second(0) {}
+
+		QList<int> fired;
+		int first;
+		int second;
+
+	protected:
+		virtual void timerEvent(QTimerEvent* event)
+		{
+			this->fired.append(event->timerId());
+			if (this->first) {
+				this->killTimer((event->timerId() == this->first) ? this->second : this->first);
+				this->first  = 0;
+				this->second = 0;
+			}
+		}
+	};
+
+	static QList<int> firstFirings(const QList<int>& fired)
+	{
+		QList<int> res;
+		for (int i=0; i<fired.size(); ++i) {
+			if (!res.contains(fired.at(i))) {
+				res.append(fired.at(i));
+			}
+		}
+
+		return res;
+	}
+
+}
+
+/*
+ * Coarse timers started while the wheel is enabled live in the wheel until they are unregistered, whatever the
+ * setting is meanwhile. The wheel has 1 ms slots on its first level and 256 ms ones on the second: intervals
+ * longer than 256 ms are cascaded down before they expire.
+ */
+class tst_TimerWheel : public QObject {
+	Q_OBJECT
+private Q_SLOTS:
+	void cleanup(void);
+	void orderAcrossSlots(void);
+	void toggleWithTimersRegistered(void);
+	void longIntervalCascades(void);
+	void unregisterDuringPass(void);
+};
+
+void tst_TimerWheel::cleanup(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	disp->setTimerWheelEnabled(false);
+}
+
+void tst_TimerWheel::orderAcrossSlots(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	disp->setTimerWheelEnabled(true);
+	QVERIFY(disp->isTimerWheelEnabled());
+
+	// Far enough apart for the coarse timer slack; together they cross second level slot boundaries
+	TimerRecorder obj;
+	const int t700 = obj.startTimer(700);
+	const int t60  = obj.startTimer(60);
+	const int t300 = obj.startTimer(300);
+	const int t130 = obj.startTimer(130);
+
+	LIBUV_TRY_VERIFY(firstFirings(obj.fired).size() == 4);
+
+	QList<int> expected;
+	expected << t60 << t130 << t300 << t700;
+	QCOMPARE(firstFirings(obj.fired), expected);
+
+	obj.killTimer(t60);
+	obj.killTimer(t130);
+	obj.killTimer(t300);
+	obj.killTimer(t700);
+}
+
+void tst_TimerWheel::toggleWithTimersRegistered(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	TimerRecorder obj;
+	const int plain = obj.startTimer(40);
+
+	disp->setTimerWheelEnabled(true);
+	const int wheel = obj.startTimer(40);
+
+	disp->setTimerWheelEnabled(false);
+	const int late = obj.startTimer(40);
+
+	QCOMPARE(disp->registeredTimers(&obj).size(), 3);
+	LIBUV_TRY_VERIFY(obj.fired.count(plain) >= 2 && obj.fired.count(wheel) >= 2 && obj.fired.count(late) >= 2);
+
+	// The wheel timer is taken out of the wheel although the wheel is off now
+	obj.killTimer(wheel);
+	QCOMPARE(disp->registeredTimers(&obj).size(), 2);
+
+	const int count = obj.fired.count(wheel);
+	LIBUV_TRY_VERIFY(obj.fired.count(plain) >= 5 && obj.fired.count(late) >= 5);
+	QCOMPARE(obj.fired.count(wheel), count);
+
+	// Enabling the wheel again reuses it
+	disp->setTimerWheelEnabled(true);
+	const int again = obj.startTimer(40);
+	LIBUV_TRY_VERIFY(obj.fired.count(again) >= 2);
+
+	obj.killTimer(plain);
+	obj.killTimer(late);
+	obj.killTimer(again);
+}
+
+void tst_TimerWheel::longIntervalCascades(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	disp->setTimerWheelEnabled(true);
+
+	// 1100 ms spans several second level slots, 70 s needs the third level
+	TimerRecorder obj;
+	const int longer  = obj.startTimer(1100);
+	const int longest = obj.startTimer(70000);
+
+	QTest::qWait(800);
+	QVERIFY(obj.fired.isEmpty());
+
+	LIBUV_TRY_COMPARE(obj.fired.size(), 1);
+	QCOMPARE(obj.fired.at(0), longer);
+
+#if QT_VERSION >= 0x050000
+	const int remaining = disp->remainingTime(longest);
+	QVERIFY(remaining > 60000);
+	QVERIFY(remaining <= 70000);
+#endif
+
+	obj.killTimer(longer);
+	obj.killTimer(longest);
+}
+
+void tst_TimerWheel::unregisterDuringPass(void)
+{
+	EventDispatcherLibUv* disp = qobject_cast<EventDispatcherLibUv*>(QAbstractEventDispatcher::instance());
+	QVERIFY(disp != 0);
+
+	disp->setTimerWheelEnabled(true);
+
+	TimerKiller obj;
+	const int first  = obj.startTimer(30);
+	const int second = obj.startTimer(30);
+	obj.first        = first;
+	obj.second       = second;
+
+	// Both expire by the time the loop runs: they come out of the wheel in the same pass
+	QTest::qSleep(100);
+	disp->processEvents(QEventLoop::AllEvents);
+
+	QCOMPARE(obj.fired.size(), 1);
+	QVERIFY(!obj.first);
+
+	// Whichever came first has killed the other one for good
+	const int survivor = obj.fired.at(0);
+	const int killed   = (survivor == first) ? second : first;
+	LIBUV_TRY_VERIFY(obj.fired.count(survivor) >= 4);
+	QVERIFY(!obj.fired.contains(killed));
+	QCOMPARE(disp->registeredTimers(&obj).size(), 1);
+
+	obj.killTimer(survivor);
+}
+
+LIBUV_TEST_MAIN(tst_TimerWheel)
+
+#include "tst_timerwheel.moc"
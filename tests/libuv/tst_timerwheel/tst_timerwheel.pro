@@ -0,0 +1,4 @@
+TARGET   = tst_timerwheel
+SOURCES += tst_timerwheel.cpp
+
+include(../libuvtest.pri)